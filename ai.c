@@ -25,45 +25,53 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#include <pthread.h>
 
 #include <epicsExport.h>
 #include <devSup.h>
 #include <dbAccess.h>
 #include <recSup.h>
+#include <recGbl.h>
+#include <alarm.h>
 #include <aiRecord.h>
 
 /*Application includes*/
 #include "parse.h"
 #include "evr.h"
 
-/*Macros*/
-#define NUMBER_OF_IO	100
-
-/*Local variables*/
-static	io_t		io[NUMBER_OF_IO];
-static	uint32_t	ioCount;
-
 /*Function prototypes*/
-static	long	init		(int after);
 static	long	initRecord	(aiRecord *record);
 static 	long	ioRecord	(aiRecord *record);
-static	void*	thread		(void* arg);
-
-/*Function definitions*/
+static	void	process		(void* arg);
+static	long	getPulserDelay	(io_t *private, void *record);
+static	long	getPulserWidth	(io_t *private, void *record);
+static	long	getPdpDelay	(io_t *private, void *record);
+static	long	getPdpWidth	(io_t *private, void *record);
+static	long	getQueueLatency	(io_t *private, void *record);
+static	long	getRtt	(io_t *private, void *record);
+static	long	getTimeout	(io_t *private, void *record);
+static	long	getApiLatency	(io_t *private, void *record);
+static	long	getApiWait	(io_t *private, void *record);
+static	long	getApiWire	(io_t *private, void *record);
+static	long	getApiTail	(io_t *private, void *record);
 
-/** 
- * @brief 	Initializes record count
- *
- * @return	0 on success, -1 on failure
- */
-static long
-init(int after)
+/*Commands understood by ai records*/
+static	const	command_t	commands[]	=
 {
-	if (!after)
-		ioCount = 0;
-	return 0;
-}
+	{"getPulserDelay",	getPulserDelay},
+	{"getPulserWidth",	getPulserWidth},
+	{"getPdpDelay",	getPdpDelay},
+	{"getPdpWidth",	getPdpWidth},
+	{"getQueueLatency",	getQueueLatency},
+	{"getRtt",	getRtt},
+	{"getTimeout",	getTimeout},
+	{"getApiLatency",	getApiLatency},
+	{"getApiWait",	getApiWait},
+	{"getApiWire",	getApiWire},
+	{"getApiTail",	getApiTail},
+	{NULL,	NULL}
+};
+
+/*Function definitions*/
 
 /** 
  * @brief 	Initializes the record
@@ -81,34 +89,43 @@ static long
 initRecord(aiRecord *record)
 {
 	int32_t	status;
+	io_t	*private;
 
-	if (ioCount >= NUMBER_OF_IO)
+	if (record->inp.type != INST_IO) 
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Too many records\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
 		return -1;
 	}
-	if (record->inp.type != INST_IO) 
+
+	private	=	evr_allocate();
+	if (!private)
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Could not allocate private structure\r\n", record->name);
 		return -1;
 	}
 
-	status			=	evr_parse(&io[ioCount], record->inp.value.instio.string);
+	status			=	evr_parse(private, record->inp.value.instio.string);
 	if (status < 0)
 	{
 		printf("[evr][initRecord] Unable to initialize %s: Could not parse parameters\r\n", record->name);
 		return -1;
 	}
 
-	io[ioCount].device	=	evr_open(io[ioCount].name);	
-	if (io[ioCount].device == NULL)
+	status			=	evr_resolve(private, commands);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Unknown command\r\n", record->name);
+		return -1;
+	}
+
+	private->device	=	evr_open(private->name);	
+	if (private->device == NULL)
 	{
 		printf("[evr][initRecord] Unable to initalize %s: Could not open device\r\n", record->name);
 		return -1;
 	}
 
-	record->dpvt	=	&io[ioCount];
-	ioCount++;
+	record->dpvt	=	private;
 
 	return 0;
 }
@@ -129,7 +146,6 @@ ioRecord(aiRecord *record)
 {
 	int32_t		status	=	0;
 	io_t*		private	=	(io_t*)record->dpvt;
-	pthread_t	handle;
 
 	if (!record)
 	{
@@ -151,13 +167,14 @@ ioRecord(aiRecord *record)
 	 * Start IO
 	 */
 
-	/*If this is the first pass then start IO thread, set PACT, and return*/
+	/*If this is the first pass then queue IO to the device's worker pool, set PACT, and return*/
 	if(!record->pact)
 	{
-		status	=	pthread_create(&handle, NULL, thread, (void*)record);	
-		if (status)
+		status	=	evr_submit(private->device, process, (void*)record);
+		if (status < 0)
 		{
-			printf("[evr][ioRecord] Unable to perform IO on %s: Unable to create thread\r\n", record->name);
+			evr_log("[evr][ioRecord] Unable to perform IO on %s: Unable to queue request\n", record->name);
+			recGblSetSevr(record, SCAN_ALARM, INVALID_ALARM);
 			return -1;
 		}
 		record->pact = true;
@@ -169,7 +186,8 @@ ioRecord(aiRecord *record)
 	 */
 	if (private->status	< 0)
 	{
-		printf("[evr][ioRecord] Unable to perform IO on %s\r\n", record->name);
+		evr_log("[evr][ioRecord] Unable to perform IO on %s\n", record->name);
+		recGblSetSevr(record, evr_getAlarm(private, READ_ALARM), INVALID_ALARM);
 		record->pact=	false;
 		return -1;
 	}
@@ -181,49 +199,127 @@ ioRecord(aiRecord *record)
 /** 
  * @brief 	Performs asynchronousIO on the record
  *
- * This function attemps the following:
- * 	Detaches the thread
+ * This function is executed by a worker of the device's pool and attemps the following:
  * 	Performs the requested IO
  *	Processes the record to finalize IO
  *
- * @param	arg	:	Pointer to thread arguments
- * @return	0 on success, -1 on failure
+ * @param	arg	:	Pointer to the record
  */
-void*
-thread(void* arg)
+static void
+process(void* arg)
 {
 	int			status	=	0;
 	aiRecord*	record	=	(aiRecord*)arg;
 	io_t*		private	=	(io_t*)record->dpvt;
 
-	/*Detach thread*/
-	pthread_detach(pthread_self());
-
-	if (strcmp(private->command, "getPulserDelay") == 0)
-		status	=	evr_getPulserDelay(private->device, private->parameter, &record->val);
-	else if (strcmp(private->command, "getPulserWidth") == 0)
-		status	=	evr_getPulserWidth(private->device, private->parameter, &record->val);
-	else if (strcmp(private->command, "getPdpDelay") == 0)
-		status	=	evr_getPdpDelay(private->device, private->parameter, &record->val);
-	else if (strcmp(private->command, "getPdpWidth") == 0)
-		status	=	evr_getPdpWidth(private->device, private->parameter, &record->val);
-	else
-	{
-		printf("[evr][thread] Unable to io %s: Do not know how to process \"%s\" requested by %s\r\n", record->name, private->command, record->name);
-		private->status	=	-1;
-	}
+	private->status	=	0;
+
+	status	=	private->handler(private, record);
 	if (status < 0)
 	{
-		printf("[evr][thread] Unable to io %s\r\n", record->name);
+		evr_log("[evr][process] Unable to io %s\n", record->name);
 		private->status	=	-1;
+		private->error	=	evr_getError();
 	}
 
 	/*Process record*/
 	dbScanLock((struct dbCommon*)record);
 	(record->rset->process)(record);
 	dbScanUnlock((struct dbCommon*)record);
+}
+
+/** 
+ * @brief 	Command handlers, resolved from the command table by initRecord
+ *
+ * @param	private	:	Private structure of the record
+ * @param	record	:	Pointer to the record
+ * @return	0 on success, -1 on failure
+ */
+static long
+getPulserDelay(io_t *private, void *record)
+{
+	return evr_getPulserDelay(private->device, private->parameter, &((aiRecord*)record)->val);
+}
+
+static long
+getPulserWidth(io_t *private, void *record)
+{
+	return evr_getPulserWidth(private->device, private->parameter, &((aiRecord*)record)->val);
+}
+
+static long
+getPdpDelay(io_t *private, void *record)
+{
+	return evr_getPdpDelay(private->device, private->parameter, &((aiRecord*)record)->val);
+}
+
+static long
+getPdpWidth(io_t *private, void *record)
+{
+	return evr_getPdpWidth(private->device, private->parameter, &((aiRecord*)record)->val);
+}
 
-	return NULL;
+static long
+getQueueLatency(io_t *private, void *record)
+{
+	return evr_getQueueLatency(private->device, &((aiRecord*)record)->val);
+}
+
+static long
+getRtt(io_t *private, void *record)
+{
+	return evr_getRtt(private->device, &((aiRecord*)record)->val);
+}
+
+static long
+getTimeout(io_t *private, void *record)
+{
+	return evr_getTimeout(private->device, &((aiRecord*)record)->val);
+}
+
+/*Statistics of the function named by the api key, averages and percentiles in ms*/
+static long
+getApiLatency(io_t *private, void *record)
+{
+	evrstats_t	stats;
+
+	if (evr_getApiStats(private->device, private->api, &stats) < 0)
+		return -1;
+	((aiRecord*)record)->val	=	stats.calls ? stats.total/(stats.calls*1e6) : 0;
+	return 0;
+}
+
+static long
+getApiWait(io_t *private, void *record)
+{
+	evrstats_t	stats;
+
+	if (evr_getApiStats(private->device, private->api, &stats) < 0)
+		return -1;
+	((aiRecord*)record)->val	=	stats.calls ? stats.wait/(stats.calls*1e6) : 0;
+	return 0;
+}
+
+static long
+getApiWire(io_t *private, void *record)
+{
+	evrstats_t	stats;
+
+	if (evr_getApiStats(private->device, private->api, &stats) < 0)
+		return -1;
+	((aiRecord*)record)->val	=	stats.calls ? stats.wire/(stats.calls*1e6) : 0;
+	return 0;
+}
+
+static long
+getApiTail(io_t *private, void *record)
+{
+	evrstats_t	stats;
+
+	if (evr_getApiStats(private->device, private->api, &stats) < 0)
+		return -1;
+	((aiRecord*)record)->val	=	stats.tail/1e6;
+	return 0;
 }
 
 struct devsup {
@@ -238,7 +334,7 @@ struct devsup {
 {
     6,
     NULL,
-    init,
+    NULL,
     initRecord,
     NULL,
     ioRecord,
@@ -28,7 +28,6 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <pthread.h>
 
 /*EPICS includes*/
 #include <epicsExport.h>
@@ -36,39 +35,41 @@
 #include <errlog.h>
 #include <dbAccess.h>
 #include <recSup.h>
+#include <recGbl.h>
+#include <alarm.h>
 #include <biRecord.h>
 
 /*Application includes*/
 #include "parse.h"
 #include "evr.h"
 
-/*Macros*/
-#define NUMBER_OF_IO	100
-
-/*Local variables*/
-static	io_t		io[NUMBER_OF_IO];
-static	uint32_t	ioCount;
-
 /*Function prototypes*/
-static	long	init		(int after);
 static	long	initRecord	(biRecord *record);
 static 	long	ioRecord	(biRecord *record);
-static	void*	thread		(void* arg);
-
-/*Function definitions*/
+static	void	process		(void* arg);
+static	long	isEnabled	(io_t *private, void *record);
+static	long	isPulserEnabled	(io_t *private, void *record);
+static	long	isPdpEnabled	(io_t *private, void *record);
+static	long	isCmlEnabled	(io_t *private, void *record);
+static	long	isRxViolation	(io_t *private, void *record);
+static	long	isOnline	(io_t *private, void *record);
+static	long	isDbusSet	(io_t *private, void *record);
+static	long	ioIntInfo	(int command, biRecord *record, IOSCANPVT *scan);
 
-/** 
- * @brief 	Initializes record count
- *
- * @return	0 on success, -1 on failure
- */
-static long
-init(int after)
+/*Commands understood by bi records*/
+static	const	command_t	commands[]	=
 {
-	if (!after)
-		ioCount = 0;
-	return 0;
-}
+	{"isEnabled",	isEnabled},
+	{"isPulserEnabled",	isPulserEnabled},
+	{"isPdpEnabled",	isPdpEnabled},
+	{"isCmlEnabled",	isCmlEnabled},
+	{"isRxViolation",	isRxViolation},
+	{"isOnline",	isOnline},
+	{"isDbusSet",	isDbusSet},
+	{NULL,	NULL}
+};
+
+/*Function definitions*/
 
 /** 
  * @brief 	Initializes the record
@@ -86,34 +87,43 @@ static long
 initRecord(biRecord *record)
 {
 	int32_t	status;
+	io_t	*private;
 
-	if (ioCount >= NUMBER_OF_IO)
+	if (record->inp.type != INST_IO) 
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Too many records\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
 		return -1;
 	}
-	if (record->inp.type != INST_IO) 
+
+	private	=	evr_allocate();
+	if (!private)
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Could not allocate private structure\r\n", record->name);
 		return -1;
 	}
 
-	status			=	evr_parse(&io[ioCount], record->inp.value.instio.string);
+	status			=	evr_parse(private, record->inp.value.instio.string);
 	if (status < 0)
 	{
 		printf("[evr][initRecord] Unable to initialize %s: Could not parse parameters\r\n", record->name);
 		return -1;
 	}
 
-	io[ioCount].device	=	evr_open(io[ioCount].name);	
-	if (io[ioCount].device == NULL)
+	status			=	evr_resolve(private, commands);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Unknown command\r\n", record->name);
+		return -1;
+	}
+
+	private->device	=	evr_open(private->name);	
+	if (private->device == NULL)
 	{
 		printf("[evr][initRecord] Unable to initalize %s: Could not open device\r\n", record->name);
 		return -1;
 	}
 
-	record->dpvt	=	&io[ioCount];
-	ioCount++;
+	record->dpvt	=	private;
 
 	return 0;
 }
@@ -134,7 +144,6 @@ ioRecord(biRecord *record)
 {
 	int32_t		status	=	0;
 	io_t*		private	=	(io_t*)record->dpvt;
-	pthread_t	handle;
 
 	if (!record)
 	{
@@ -156,13 +165,14 @@ ioRecord(biRecord *record)
 	 * Start IO
 	 */
 
-	/*If this is the first pass then start IO thread, set PACT, and return*/
+	/*If this is the first pass then queue IO to the device's worker pool, set PACT, and return*/
 	if(!record->pact)
 	{
-		status	=	pthread_create(&handle, NULL, thread, (void*)record);	
-		if (status)
+		status	=	evr_submit(private->device, process, (void*)record);
+		if (status < 0)
 		{
-			printf("[evr][ioRecord] Unable to perform IO on %s: Unable to create thread\r\n", record->name);
+			evr_log("[evr][ioRecord] Unable to perform IO on %s: Unable to queue request\n", record->name);
+			recGblSetSevr(record, SCAN_ALARM, INVALID_ALARM);
 			return -1;
 		}
 		record->pact = true;
@@ -174,7 +184,8 @@ ioRecord(biRecord *record)
 	 */
 	if (private->status	< 0)
 	{
-		printf("[evr][ioRecord] Unable to perform IO on %s\r\n", record->name);
+		evr_log("[evr][ioRecord] Unable to perform IO on %s\n", record->name);
+		recGblSetSevr(record, evr_getAlarm(private, READ_ALARM), INVALID_ALARM);
 		record->pact=	false;
 		return -1;
 	}
@@ -186,43 +197,27 @@ ioRecord(biRecord *record)
 /** 
  * @brief 	Performs asynchronousIO on the record
  *
- * This function attemps the following:
- * 	Detaches the thread
+ * This function is executed by a worker of the device's pool and attemps the following:
  * 	Performs the requested IO
  *	Processes the record to finalize IO
  *
- * @param	arg	:	Pointer to thread arguments
- * @return	0 on success, -1 on failure
+ * @param	arg	:	Pointer to the record
  */
-void*
-thread(void* arg)
+static void
+process(void* arg)
 {
 	int			status	=	0;
 	biRecord*	record	=	(biRecord*)arg;
 	io_t*		private	=	(io_t*)record->dpvt;
 
-	/*Detach thread*/
-	pthread_detach(pthread_self());
-
-	if (strcmp(private->command, "isEnabled") == 0)
-		status	=	evr_isEnabled(private->device);
-	else if (strcmp(private->command, "isPulserEnabled") == 0)
-		status	=	evr_isPulserEnabled(private->device, private->parameter);
-	else if (strcmp(private->command, "isPdpEnabled") == 0)
-		status	=	evr_isPdpEnabled(private->device, private->parameter);
-	else if (strcmp(private->command, "isCmlEnabled") == 0)
-		status	=	evr_isCmlEnabled(private->device, private->parameter);
-	else if (strcmp(private->command, "isRxViolation") == 0)
-		status	=	evr_isRxViolation(private->device);
-	else
-	{
-		printf("[evr][thread] Unable to io %s: Do not know how to process \"%s\" requested by %s\r\n", record->name, private->command, record->name);
-		private->status	=	-1;
-	}
+	private->status	=	0;
+
+	status	=	private->handler(private, record);
 	if (status < 0)
 	{
-		printf("[evr][thread] Unable to io %s\r\n", record->name);
+		evr_log("[evr][process] Unable to io %s\n", record->name);
 		private->status	=	-1;
+		private->error	=	evr_getError();
 	}
 	else
 		record->rval	=	status;
@@ -231,8 +226,128 @@ thread(void* arg)
 	dbScanLock((struct dbCommon*)record);
 	(record->rset->process)(record);
 	dbScanUnlock((struct dbCommon*)record);
+}
+
+/** 
+ * @brief 	Command handlers, resolved from the command table by initRecord
+ *
+ * @param	private	:	Private structure of the record
+ * @param	record	:	Pointer to the record
+ * @return	0 on success, -1 on failure, or the state read for bi records
+ */
+static long
+isEnabled(io_t *private, void *record)
+{
+	return evr_isEnabled(private->device);
+}
+
+static long
+isPulserEnabled(io_t *private, void *record)
+{
+	return evr_isPulserEnabled(private->device, private->parameter);
+}
+
+static long
+isPdpEnabled(io_t *private, void *record)
+{
+	return evr_isPdpEnabled(private->device, private->parameter);
+}
+
+static long
+isCmlEnabled(io_t *private, void *record)
+{
+	return evr_isCmlEnabled(private->device, private->parameter);
+}
 
-	return NULL;
+static long
+isRxViolation(io_t *private, void *record)
+{
+	return evr_isRxViolation(private->device);
+}
+
+static long
+isOnline(io_t *private, void *record)
+{
+	return evr_isOnline(private->device);
+}
+
+static long
+isDbusSet(io_t *private, void *record)
+{
+	uint8_t	data;
+
+	if (private->parameter >= 8 || evr_getDbus(private->device, &data) < 0)
+		return -1;
+	return (data >> private->parameter) & 1;
+}
+
+/** 
+ * @brief 	Returns the I/O Intr scan list of the record
+ *
+ * Only commands that read a single status register can be scanned on I/O Intr,
+ * the record is then scanned by the device's status poller whenever the register changes.
+ * A deleted record releases the register, which is no longer polled once no record uses it.
+ * Distributed bus records are scanned only when their own bit changes.
+ *
+ * @param	command	:	0 if the record is added to the scan list, 1 if it is deleted
+ * @param	record	:	Pointer to the record
+ * @param	scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+static long
+ioIntInfo(int command, biRecord *record, IOSCANPVT *scan)
+{
+	long			status;
+	evrregister_t	reg;
+	io_t*			private	=	(io_t*)record->dpvt;
+
+	if (!private)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: Null private structure pointer\r\n", record->name);
+		return -1;
+	}
+
+	if (private->handler == isDbusSet)
+	{
+		if (private->parameter >= 8)
+			status	=	-1;
+		else if (command)
+			status	=	evr_releaseBitScan(private->device, REGISTER_DBUS_DATA, private->parameter, scan);
+		else
+			status	=	evr_getBitScan(private->device, REGISTER_DBUS_DATA, private->parameter, scan);
+		if (status < 0)
+		{
+			printf("[evr][ioIntInfo] Unable to scan %s\r\n", record->name);
+			return -1;
+		}
+		return 0;
+	}
+
+	if (private->handler == isEnabled || private->handler == isRxViolation)
+		reg	=	REGISTER_CONTROL;
+	else if (private->handler == isPulserEnabled)
+		reg	=	REGISTER_PULSE_ENABLE;
+	else if (private->handler == isPdpEnabled)
+		reg	=	REGISTER_PDP_ENABLE;
+	else if (private->handler == isCmlEnabled && private->parameter < NUMBER_OF_CML)
+		reg	=	REGISTER_CML4_ENABLE + private->parameter*0x20;
+	else
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: \"%s\" cannot be scanned on I/O Intr\r\n", record->name, private->command);
+		return -1;
+	}
+
+	if (command)
+		status	=	evr_releaseIoScan(private->device, reg, scan);
+	else
+		status	=	evr_getIoScan(private->device, reg, scan);
+	if (status < 0)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s\r\n", record->name);
+		return -1;
+	}
+
+	return 0;
 }
 
 struct devsup {
@@ -246,9 +361,9 @@ struct devsup {
 {
     5,
     NULL,
-    init,
-    initRecord,
     NULL,
+    initRecord,
+    ioIntInfo,
     ioRecord,
 };
 epicsExportAddress(dset, bievr);
@@ -28,11 +28,16 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <unistd.h>
 #include <limits.h>
+#include <errno.h>
 #include <pthread.h>
-#include <poll.h>
+#include <sched.h>
+#include <time.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
@@ -41,6 +46,8 @@
 #include <epicsExport.h>
 #include <drvSup.h>
 #include <iocsh.h>
+#include <errlog.h>
+#include <generalTimeSup.h>
 
 /*Application headers*/
 #include "evr.h"
@@ -49,41 +56,458 @@
  * Macros
  */
 
+/** @brief request_t represents a single register access within a pipelined transfer*/
+typedef struct
+{
+	uint8_t			access;		/*Read/Write*/
+	evrregister_t	reg;		/*Register address*/
+	uint16_t		data;		/*Data to be written, or data read back*/
+	int32_t			status;		/*0 on success, -1 on failure*/
+} request_t;
+
+/** @brief slot_t tracks a request that is in flight*/
+typedef struct slot
+{
+	request_t		*request;	/*Request occupying the slot, NULL if the slot is free*/
+	message_t		message;	/*Message as sent on the wire*/
+	uint32_t		retries;	/*Number of retransmissions so far*/
+	struct timespec	deadline;	/*Time at which the request is retransmitted*/
+	struct timespec	first;		/*Time of the first transmission*/
+	struct timespec	sent;		/*Time of the last transmission*/
+	uint32_t		timeout;	/*Retransmission timeout in us, doubled on every retransmission*/
+	bool			done;		/*True once the request completed, successfully or not*/
+	void			(*complete)(void *device, struct slot *slot);	/*Called by the reactor when the request completes*/
+} slot_t;
+
+#define REGISTER_SPACE		0x100	/*Size of the directly addressed register space in bytes*/
+
+/** @brief shadow_t holds the last known value of a register*/
+typedef struct
+{
+	uint16_t		data;		/*Last value read from or written to the register*/
+	bool			valid;		/*True if data reflects the register*/
+	struct timespec	stamp;		/*Time at which data was last confirmed*/
+} shadow_t;
+
+#define NUMBER_OF_SLOTS		16		/*Maximum number of requests in flight per device*/
+#define NUMBER_OF_CHECKS	32		/*Maximum number of deferred write verifications per device*/
+#define VERIFY_IDLE			1000	/*Time in ms the verifier sleeps while no verification period is configured*/
+#define NUMBER_OF_WORKERS	2		/*Number of worker threads per device*/
+#define QUEUE_SIZE			256		/*Maximum number of jobs waiting for a worker, per device*/
+
+#define REGISTER_BITS		16		/*Number of bits of a register*/
+
+/** @brief monitor_t tracks a register watched by the status poller*/
+typedef struct
+{
+	IOSCANPVT		scan;		/*Records scanned on I/O Intr when the register changes, NULL if the register was never watched*/
+	IOSCANPVT		bits[REGISTER_BITS];	/*Records scanned on I/O Intr when a bit of the register changes, per bit, NULL if none*/
+	uint32_t		users;		/*Number of records on the scan lists of the register, the register is polled only if not 0*/
+	uint16_t		data;		/*Value seen by the last poll*/
+	bool			valid;		/*True if the last poll succeeded*/
+} monitor_t;
+
+#define FIFO_SIZE			4096	/*Number of events kept by the event ring, a power of two*/
+#define FIFO_BURST			16		/*Number of event FIFO pops between two pauses of the drain*/
+#define FIFO_PAUSE			100		/*Pause in us between back to back event FIFO reads*/
+
+#define LOG_PERIOD			100		/*Period in ms the event log is written at*/
+#define TAP_TIMEOUT			10		/*Time in s the event tap waits for events*/
+
+/**
+ * @brief fifo_t holds the events drained from the event FIFO of a device
+ *
+ * The ring has a single producer, the drain, and any number of consumers, see evr_subscribe.
+ * Consumers keep their own cursor, so none of them slows the others or the drain down.
+ * The head and the ring start on their own cache lines, so consumers polling the head do not
+ * share a line with the entries being written.
+ */
+typedef struct
+{
+	uint32_t		period;							/*Period in ms the FIFO is polled at once it is found empty, 0 disables the drain*/
+	uint64_t		head		__attribute__((aligned(CACHE_LINE)));	/*Number of events ever pushed, the newest is ring[(head - 1)%FIFO_SIZE]*/
+	evrevent_t		ring[FIFO_SIZE]	__attribute__((aligned(CACHE_LINE)));	/*Most recent events, overwritten oldest first*/
+	uint64_t		counts[NUMBER_OF_EVENTS]	__attribute__((aligned(CACHE_LINE)));	/*Number of events received per code*/
+	uint32_t		stamps[NUMBER_OF_EVENTS];		/*Timestamp of the last event received per code*/
+	IOSCANPVT		scans[NUMBER_OF_EVENTS];		/*Records scanned when an event is received, per code*/
+	uint64_t		reads;							/*Number of FIFO reads*/
+	uint64_t		errors;							/*Number of FIFO reads that failed*/
+} fifo_t;
+
+#define RECORDER_SIZE		4096	/*Number of transactions kept by the flight recorder, a power of two*/
+#define DUMP_COUNT			20		/*Number of transactions evrDumpTransactions prints by default*/
+
+/**
+ * @brief recorder_t is the flight recorder of a device: the most recent register transactions
+ *
+ * Transactions are recorded by the reactor as they complete, with the slot lock of the device held,
+ * so the ring has a single producer at a time. Readers take no lock and keep their own cursor,
+ * as the consumers of the event ring do, see evr_getTransactions.
+ */
+typedef struct
+{
+	uint64_t			head	__attribute__((aligned(CACHE_LINE)));	/*Number of transactions ever recorded, the newest is ring[(head - 1)%RECORDER_SIZE]*/
+	evrtransaction_t	ring[RECORDER_SIZE]	__attribute__((aligned(CACHE_LINE)));	/*Most recent transactions, overwritten oldest first*/
+} recorder_t;
+
+#define TIME_TOLERANCE		10		/*Time in ms the timestamp counter may stray from its expected value before it is taken as reset*/
+#define TIME_PRIORITY		50		/*Priority of the event time provider, the OS clock provides no event time*/
+#define CURRENT_PRIORITY	(LAST_RESORT_PRIORITY + 1)	/*Priority of the current time provider, after the OS clock since the device does not know the date*/
+
+/**
+ * @brief timebase_t relates the timestamp counter of a device to EPICS time
+ *
+ * The counter is sampled every period, together with the microsecond divider, and extended to 64 bits across its wraps.
+ * It ticks at the event frequency divided by the divider, so its rate follows the clock set by evr_setClock.
+ * The VME-EVR-230 has no seconds register and receives no date from the event stream, only this free running counter,
+ * so the counter is anchored to the host clock once, by the first sample; from then on time follows the counter,
+ * which is continued rather than re-anchored when the device resets it.
+ * Between samples the current time is extrapolated from the host monotonic clock, so time requests never wait for the device.
+ */
+typedef struct
+{
+	uint32_t		period;		/*Period in ms the counter is sampled at, 0 disables sampling*/
+	pthread_mutex_t	mutex;		/*Mutex for the members below*/
+	bool			valid;		/*True once the counter was sampled*/
+	uint32_t		raw;		/*Counter value of the last sample*/
+	uint64_t		ticks;		/*Extended counter value of the last sample*/
+	uint64_t		rate;		/*Counter ticks per second at the last sample*/
+	struct timespec	sampled;	/*Monotonic time of the last sample*/
+	int64_t			time;		/*Time in ns since the POSIX epoch of the last sample*/
+	uint64_t		samples;	/*Number of successful samples*/
+	uint64_t		errors;		/*Number of failed samples*/
+	uint64_t		resets;		/*Number of times the counter was found reset*/
+} timebase_t;
+
+#define DATA_BUFFERS		8		/*Number of data buffers per device*/
+
+/**
+ * @brief databuf_t holds the buffers received through distributed data transmission
+ *
+ * Buffers are filled by the receiver and handed to their readers by reference. A buffer is
+ * refilled only once nobody holds it, so readers never see it change.
+ */
+typedef struct
+{
+	uint32_t		period;		/*Period in ms the receiver is polled at, 0 disables the receiver*/
+	pthread_mutex_t	mutex;		/*Mutex for the members below and the references to the buffers*/
+	evrbuffer_t		*buffers;	/*Buffer pool, DATA_BUFFERS buffers*/
+	evrbuffer_t		*latest;	/*Most recently received buffer, NULL if none*/
+	IOSCANPVT		scan;		/*Records scanned when a buffer is received*/
+	uint64_t		received;	/*Number of buffers received*/
+	uint64_t		errors;		/*Number of buffers that failed their checksum*/
+	uint64_t		failures;	/*Number of buffers that could not be read*/
+	uint64_t		dropped;	/*Number of buffers dropped because the whole pool was held*/
+} databuf_t;
+
+/** @brief log_t is an event log, see evrLogEvents*/
+typedef struct
+{
+	evrsubscriber_t	subscriber;		/*Position of the log in the event ring*/
+	FILE			*file;			/*Log file*/
+} log_t;
+
+/** @brief job_t is a unit of asynchronous work, typically the IO of one record*/
+typedef struct
+{
+	void			(*function)(void*);	/*Function to be executed by a worker*/
+	void			*arg;				/*Argument passed to the function*/
+	evrerror_t		error;				/*Failure the function finds with evr_getError, see evr_complete*/
+	struct timespec	queued;				/*Time at which the job was queued*/
+} job_t;
+
+/** @brief queue_t is the bounded job queue served by the worker pool of a device*/
+typedef struct
+{
+	pthread_mutex_t	mutex;				/*Mutex for accessing the queue*/
+	pthread_cond_t	condition;			/*Signaled when a job is queued*/
+	job_t			jobs[QUEUE_SIZE];	/*Circular buffer of queued jobs*/
+	uint32_t		head;				/*Index of the oldest queued job*/
+	uint32_t		depth;				/*Number of queued jobs*/
+	uint32_t		peak;				/*Highest depth seen*/
+	uint64_t		processed;			/*Number of jobs executed*/
+	uint64_t		rejected;			/*Number of jobs refused because the queue was full*/
+	uint64_t		wait;				/*Total time in ns jobs spent queued*/
+	uint64_t		service;			/*Total time in ns spent executing jobs*/
+	uint64_t		worst;				/*Longest time in ns from queueing to completion*/
+} queue_t;
+
+/** @brief Write verification modes*/
+typedef enum
+{
+	VERIFY_IMMEDIATE,	/*Every write is read back before the next access*/
+	VERIFY_DEFERRED,	/*Writes are read back together, when the calling function completes or by the verifier*/
+} verify_t;
+
+/** @brief waiter_t gathers the outcome of the deferred read-backs of a thread's writes until it asks to be completed, see evr_complete*/
+typedef struct
+{
+	bool			used;				/*True if the entry belongs to a thread*/
+	pthread_t		thread;				/*Thread whose writes are gathered*/
+	uint32_t		checks;				/*Number of read-backs not done yet*/
+	evrerror_t		error;				/*Reason of the first failed read-back, EVR_ERROR_NONE if none*/
+	void			(*function)(void*);	/*Executed by a worker once all read-backs are done, NULL until evr_complete*/
+	void			*arg;				/*Argument passed to the function*/
+} waiter_t;
+
+/** @brief check_t is a write waiting for its deferred read-back*/
+typedef struct
+{
+	evrregister_t	reg;				/*Register written*/
+	uint16_t		data;				/*Data written*/
+	waiter_t		*waiter;			/*Thread the outcome is reported to, NULL if none*/
+} check_t;
+
+/** @brief state_t tells whether the device was brought up*/
+typedef enum
+{
+	STATE_STARTING,		/*The device is being brought up, requests of other threads than its starter fail without being sent*/
+	STATE_ONLINE,		/*The device was brought up*/
+	STATE_OFFLINE,		/*Init did not run yet, the device could not be brought up or it stopped answering, requests fail without being sent*/
+} state_t;
+
+/** @brief api_t identifies the public functions whose calls are timed, see acquire()*/
+typedef enum
+{
+	API_ENABLE,
+	API_IS_ENABLED,
+	API_FLUSH,
+	API_SET_CLOCK,
+	API_GET_CLOCK,
+	API_ENABLE_PULSER,
+	API_IS_PULSER_ENABLED,
+	API_SET_PULSER_DELAY,
+	API_GET_PULSER_DELAY,
+	API_SET_PULSER_WIDTH,
+	API_GET_PULSER_WIDTH,
+	API_ENABLE_PDP,
+	API_IS_PDP_ENABLED,
+	API_SET_PDP_PRESCALER,
+	API_GET_PDP_PRESCALER,
+	API_SET_PDP_DELAY,
+	API_GET_PDP_DELAY,
+	API_SET_PDP_WIDTH,
+	API_GET_PDP_WIDTH,
+	API_ENABLE_CML,
+	API_IS_CML_ENABLED,
+	API_SET_CML_PRESCALER,
+	API_GET_CML_PRESCALER,
+	API_SET_MAP,
+	API_GET_MAP,
+	API_SET_MAP_TABLE,
+	API_GET_MAP_TABLE,
+	API_SET_PRESCALER,
+	API_GET_PRESCALER,
+	API_SET_TTL_SOURCE,
+	API_GET_TTL_SOURCE,
+	API_SET_UNIV_SOURCE,
+	API_GET_UNIV_SOURCE,
+	API_GET_FIRMWARE_VERSION,
+	API_RESET_RX_VIOLATION,
+	API_GET_DBUS,
+	API_IS_RX_VIOLATION,
+	API_READ_REGS,
+	API_WRITE_REGS,
+	API_REFRESH,
+	API_VERIFY,
+	NUMBER_OF_APIS
+} api_t;
+
+/*Names of the timed public functions, indexed by api_t*/
+static	const	char	*apiNames[NUMBER_OF_APIS]	=
+{
+	"enable",
+	"isEnabled",
+	"flush",
+	"setClock",
+	"getClock",
+	"enablePulser",
+	"isPulserEnabled",
+	"setPulserDelay",
+	"getPulserDelay",
+	"setPulserWidth",
+	"getPulserWidth",
+	"enablePdp",
+	"isPdpEnabled",
+	"setPdpPrescaler",
+	"getPdpPrescaler",
+	"setPdpDelay",
+	"getPdpDelay",
+	"setPdpWidth",
+	"getPdpWidth",
+	"enableCml",
+	"isCmlEnabled",
+	"setCmlPrescaler",
+	"getCmlPrescaler",
+	"setMap",
+	"getMap",
+	"setMapTable",
+	"getMapTable",
+	"setPrescaler",
+	"getPrescaler",
+	"setTTLSource",
+	"getTTLSource",
+	"setUNIVSource",
+	"getUNIVSource",
+	"getFirmwareVersion",
+	"resetRxViolation",
+	"getDbus",
+	"isRxViolation",
+	"readRegs",
+	"writeRegs",
+	"refresh",
+	"verify",
+};
+
+#define HOST_LENGTH	256		/*Maximum length of a device host name*/
+
 /** @brief Structure that holds configuration information for every device*/
 typedef struct
 {
 	char			name[NAME_LENGTH];	/*Device name*/
-	in_addr_t		ip;					/*Device IP in network byte-order*/
+	char			host[HOST_LENGTH];	/*Device host name or dotted address, as configured*/
+	in_addr_t		ip;					/*Device IP in network byte-order, INADDR_NONE if unknown, protected by lock*/
+	in_addr_t		resolved;			/*Address found by the initial resolution, INADDR_NONE if none, protected by startup*/
 	in_port_t		port;				/*Device port in network byte-order*/
 	uint32_t		frequency;			/*Device event frequency in MHz*/
 	pthread_mutex_t	mutex;				/*Mutex for accessing the device*/
-	int32_t			socket;				/*Socket for communicating with the device*/
+	int32_t			socket;				/*Socket for communicating with the device, -1 until init*/
+	uint32_t		reference;			/*Sequence number stamped on the next request sent to the device*/
+	pthread_mutex_t	lock;				/*Mutex for the slots shared with the reactor*/
+	state_t			state;				/*Whether the device was brought up, protected by lock*/
+	pthread_cond_t	completion;			/*Signaled when a request in flight completes*/
+	pthread_cond_t	lost;				/*Signaled when an online device stops answering and goes offline*/
+	uint32_t		timeouts;			/*Number of consecutive failed transfers, protected by lock*/
+	slot_t			slots[NUMBER_OF_SLOTS];	/*Requests in flight*/
+	uint64_t		samples;			/*Number of round trip times measured*/
+	int64_t			srtt;				/*Smoothed round trip time in us*/
+	int64_t			rttvar;				/*Round trip time variation in us*/
+	uint32_t		rto;				/*Retransmission timeout in us*/
+	uint64_t		retransmits;		/*Number of retransmissions*/
+	uint64_t		failures;			/*Number of requests that were never answered*/
+	uint64_t		stale;				/*Number of replies discarded because they match no request in flight*/
+	uint64_t		malformed;			/*Number of replies discarded because of their size or address*/
+	uint32_t		histogram[NUMBER_OF_BINS];	/*Number of transmissions per timeout, bin n counts timeouts of 2^n to 2^(n+1) us*/
+	uint32_t		age;				/*Maximum age in ms of shadow values answered from cache, 0 disables the cache*/
+	uint32_t		refresh;			/*Period in ms of the background shadow refresh, 0 disables the refresh*/
+	uint32_t		poll;				/*Period in ms of the status poller, 0 disables the poller*/
+	monitor_t		monitors[REGISTER_SPACE/2];	/*Directly addressed registers watched by the status poller*/
+	fifo_t			fifo;				/*Events drained from the event FIFO*/
+	recorder_t		recorder;			/*Most recent register transactions*/
+	timebase_t		timebase;			/*Time kept by the timestamp counter*/
+	databuf_t		data;				/*Buffers received through distributed data transmission*/
+	int32_t			pulseSelect;		/*Current value of REGISTER_PULSE_SELECT, -1 if unknown*/
+	int32_t			mapSelect;			/*Current value of REGISTER_MAP_ADDRESS, -1 if unknown*/
+	shadow_t		registers[REGISTER_SPACE/2];					/*Shadow of the directly addressed registers*/
+	shadow_t		pulsers[NUMBER_OF_SELECTS][PULSE_REGISTERS];	/*Shadow of the registers behind REGISTER_PULSE_SELECT*/
+	shadow_t		map[NUMBER_OF_EVENTS];							/*Shadow of the event mapping RAM*/
+	uint16_t		table[NUMBER_OF_EVENTS];	/*Mapping RAM loaded by evrLoadMap, written again whenever the device is brought up, protected by mutex*/
+	bool			loaded;				/*True if a mapping RAM was loaded by evrLoadMap, protected by mutex*/
+	queue_t			queue;				/*Jobs waiting for the worker pool*/
+	verify_t		verify;				/*Write verification mode, protected by mutex*/
+	uint32_t		interval;			/*Period in ms of the verifier, 0 to verify deferred writes when the calling function completes, protected by mutex*/
+	uint32_t		checks;				/*Number of deferred write verifications, protected by mutex*/
+	check_t			pending[NUMBER_OF_CHECKS];	/*Deferred write verifications, protected by mutex*/
+	waiter_t		waiters[NUMBER_OF_CHECKS];	/*Threads waiting for deferred write verifications, protected by mutex*/
+	evrstats_t		apis[NUMBER_OF_APIS];	/*Statistics of the calls to the public functions, protected by lock*/
 } device_t;
 
-/** @brif message_t is a structure that represents the UDP message sent/received to/from the device*/
+/**
+ * @brief call_t is the public function call the calling thread is timing
+ *
+ * A call starts when acquire() is asked for the device mutex and ends when release() unlocks it.
+ * transfer() adds the time it spends on the wire and the retransmissions of its requests.
+ */
 typedef struct
 {
-	uint8_t		access;		/*Read/Write*/
-	uint8_t		status;		/*Filled by device*/
-	uint16_t	data;		/*Register data*/
-	uint32_t	address;	/*Register address*/
-	uint32_t	reference;	/*Reserved*/
-} message_t;
-
-#define NUMBER_OF_DEVICES	10	/*Maximum number of devices allowed*/
-#define NUMBER_OF_RETRIES	3	/*Maximum number of retransmissions*/
+	device_t		*device;	/*Device the call acts upon, NULL if the thread is not timing a call*/
+	api_t			api;		/*Function being called*/
+	struct timespec	start;		/*Time at which the call asked for the device mutex*/
+	uint64_t		wait;		/*Time in ns spent waiting for the device mutex*/
+	uint64_t		wire;		/*Time in ns spent transferring requests*/
+	uint64_t		retries;	/*Number of retransmissions of the requests*/
+	bool			failed;		/*True if a transfer, read-back or deferred verification failed*/
+} call_t;
+
+static	__thread	call_t	call;	/*Call timed by the calling thread*/
+static	__thread	evrerror_t	reason;	/*Reason of the last failure of the calling thread, see evr_getError*/
+static	__thread	bool	starting;	/*True in the starter of a device, whose requests are sent while the device is starting*/
+
+#define TRANSACTION_SIZE	16		/*Maximum number of requests in a transaction*/
+
+/** @brief transaction_t gathers the register accesses of one logical operation so they execute as one pipelined batch*/
+typedef struct
+{
+	device_t		*device;						/*Device the transaction executes on*/
+	int32_t			pulseSelect;					/*Value of REGISTER_PULSE_SELECT once the gathered requests have executed, -1 if unknown*/
+	int32_t			mapSelect;						/*Value of REGISTER_MAP_ADDRESS once the gathered requests have executed, -1 if unknown*/
+	bool			selects;						/*True if the transaction writes a select register*/
+	bool			overflow;						/*True if more than TRANSACTION_SIZE requests were gathered*/
+	uint32_t		count;							/*Number of gathered requests*/
+	request_t		requests[TRANSACTION_SIZE];		/*Gathered requests, in order*/
+	uint16_t		*results[TRANSACTION_SIZE];		/*Where the data of each read is stored, NULL if nowhere*/
+	int32_t			checks[TRANSACTION_SIZE];		/*Index of the read-back of each write, -1 if none*/
+	uint32_t		unchecked;						/*Number of writes whose read-back is not gathered yet*/
+	uint32_t		writes[TRANSACTION_SIZE];		/*Indices of these writes*/
+} transaction_t;
+
+#define NUMBER_OF_BUCKETS	16		/*Initial number of buckets of the device name hash table, a power of two*/
+#define NUMBER_OF_READY		16		/*Maximum number of descriptors handled per reactor wakeup*/
+#define NUMBER_OF_RETRIES	3		/*Minimum number of transmissions before a request fails*/
+#define TIMEOUT				1000	/*Initial and maximum retransmission timeout, and minimum time before a request fails, in milliseconds*/
+#define MINIMUM_TIMEOUT		2		/*Minimum retransmission timeout in milliseconds*/
+#define RESOLVE_TIMEOUT		2000	/*Time in milliseconds init waits for the host names to be resolved*/
+#define STARTUP_TIMEOUT		5000	/*Time in milliseconds init waits for all devices to be brought up*/
+#define RESTART_PERIOD		10000	/*Time in milliseconds between attempts to bring an offline device up*/
+#define OFFLINE_FAILURES	3		/*Number of consecutive failed transfers that take an online device offline*/
 
 /*
  * Private members
  */
-static	device_t	devices[NUMBER_OF_DEVICES];	/*Configured devices*/
+static	device_t	**devices	=	NULL;		/*Configured devices, in configuration order*/
 static	uint32_t	deviceCount	=	0;			/*Number of configured devices*/
+static	uint32_t	deviceSize	=	0;			/*Number of entries allocated in devices*/
+static	device_t	**buckets	=	NULL;		/*Open addressing hash table of the devices by name*/
+static	uint32_t	bucketCount	=	0;			/*Number of buckets, a power of two*/
+static	int32_t		events		=	-1;			/*Epoll instance watching the sockets of all devices*/
+static	int32_t		wakeup		=	-1;			/*Event descriptor used to wake the reactor up*/
+static	pthread_mutex_t	startup	=	PTHREAD_MUTEX_INITIALIZER;	/*Mutex for started, resolutions and the resolved addresses*/
+static	pthread_cond_t	startupCondition;						/*Signaled when a device's first bring-up attempt or host name resolution ends*/
+static	uint32_t	started		=	0;			/*Number of devices whose first bring-up attempt ended*/
+static	uint32_t	resolutions	=	0;			/*Number of devices whose initial host name resolution ended*/
+static	char		addressFile[PATH_MAX]	=	"";	/*File caching the resolved addresses, empty if none*/
+static	pthread_mutex_t	saving	=	PTHREAD_MUTEX_INITIALIZER;	/*Mutex for writing the address file*/
+static	uint32_t	resolvePeriod	=	0;		/*Period in s of the host name re-resolution, 0 disables it*/
+static	device_t	*timekeeper	=	NULL;		/*Device the time providers read, NULL if none*/
+static	bool		initialized	=	false;		/*True once init ran, devices cannot be reached before*/
 
 /*
  * Private function prototypes
  */
 /*Initializes the device*/
 static	long	init		(void);
+/*Disables the device, initializes its clock, flushes its event RAM and loads the mapping RAM again*/
+static	long	start		(device_t *device);
+/*Brings a device up, retrying until it answers, then starts its background threads*/
+static	void*	starter		(void *arg);
+/*Finds the address of every device*/
+static	void	locate		(void);
+/*Resolves a host name into an IPv4 address*/
+static	long	resolve		(const char *host, in_addr_t *ip);
+/*Resolves the host name of a device during init*/
+static	void*	resolver	(void *arg);
+/*Periodically re-resolves the host names and reconnects devices whose address changed*/
+static	void*	tracker		(void *arg);
+/*Points the socket of a device at a new address*/
+static	long	relocate	(device_t *device, in_addr_t ip);
+/*Reads the address cache file*/
+static	void	loadAddresses	(void);
+/*Writes the address cache file*/
+static	void	saveAddresses	(void);
+/*Returns the hash of a device name*/
+static	uint32_t	hash	(const char *name);
+/*Adds a device to the hash table, growing the table if needed*/
+static	long	insert		(device_t *device);
 /*Reports on all configured devices*/
 static	long	report		(int detail);
 /*Writes data and checks that it was written*/
@@ -92,6 +516,72 @@ static	long	writecheck	(void *dev, evrregister_t reg, uint16_t data);
 static	long	writereg	(void *dev, evrregister_t reg, uint16_t data);
 /*Reads data from register*/
 static	long	readreg		(void *dev, evrregister_t reg, uint16_t *data);
+/*Executes a batch of register accesses with several requests in flight*/
+static	long	transfer	(device_t *device, request_t *requests, uint32_t count);
+/*Returns the shadow entry of a register under the current selection*/
+static	shadow_t*	shadow	(device_t *device, evrregister_t reg);
+/*Returns the shadow entry of a register under the given selection*/
+static	shadow_t*	lookup	(device_t *device, evrregister_t reg, int32_t pulseSelect, int32_t mapSelect);
+/*Tests if a shadow entry is recent enough to be answered from cache*/
+static	bool	fresh		(shadow_t *entry, uint32_t age);
+/*Updates the shadow copy with the outcome of a request*/
+static	void	remember	(device_t *device, request_t *request);
+/*Forgets the shadow copy and the selections of a device that stopped answering*/
+static	void	forget		(device_t *device);
+/*Checks that a device that stopped answering answers again, and whether it was reset*/
+static	long	probe		(device_t *device);
+/*Re-reads shadowed registers from the device*/
+static	long	reload		(device_t *device, bool indirect);
+/*Periodically refreshes the shadow copy*/
+static	void*	refresher	(void *arg);
+/*Periodically reads watched registers and scans the records of those that changed*/
+static	void*	poller		(void *arg);
+/*Drains the event FIFO into the event ring*/
+static	void*	drainer		(void *arg);
+/*Writes the events of a device to a file*/
+static	void*	logger		(void *arg);
+/*Receives data buffers*/
+static	void*	receiver	(void *arg);
+/*Periodically samples the timestamp counter*/
+static	void*	sampler		(void *arg);
+/*Converts a timestamp counter value to EPICS time*/
+static	long	convert		(device_t *device, bool current, uint32_t stamp, epicsTimeStamp *time);
+/*Current time provider*/
+static	int		currentTime	(epicsTimeStamp *time);
+/*Event time provider*/
+static	int		eventTime	(epicsTimeStamp *time, int event);
+/*Executes queued jobs*/
+static	void*	worker		(void *arg);
+/*Receives replies and retransmits requests of all devices*/
+static	void*	reactor		(void *arg);
+/*Records a completed request in the flight recorder*/
+static	void	trace		(device_t *device, slot_t *slot);
+/*Returns the time in ns between two instants*/
+static	uint64_t	elapsed	(struct timespec *start, struct timespec *end);
+/*Reads back deferred writes and compares them*/
+static	long	verify		(device_t *device);
+/*Queues the read-back of a write*/
+static	void	defer		(device_t *device, evrregister_t reg, uint16_t data);
+/*Returns the waiter of the calling thread*/
+static	waiter_t*	enlist	(device_t *device, bool create);
+/*Periodically reads back deferred writes*/
+static	void*	verifier	(void *arg);
+/*Queues a job with the failure it reports*/
+static	long	enqueue		(device_t *device, void (*function)(void*), void *arg, evrerror_t error);
+/*Locks the device and starts timing a call*/
+static	void	acquire		(device_t *device, api_t api);
+/*Verifies deferred writes and unlocks the device*/
+static	long	release		(device_t *device);
+/*Starts gathering a transaction*/
+static	void	transactionBegin	(transaction_t *transaction, device_t *device);
+/*Adds a select register write to a transaction, unless the value is already selected*/
+static	void	transactionSelect	(transaction_t *transaction, evrregister_t reg, uint16_t value);
+/*Adds a register write to a transaction*/
+static	void	transactionWrite	(transaction_t *transaction, evrregister_t reg, uint16_t data, bool check);
+/*Adds a register read to a transaction*/
+static	void	transactionRead		(transaction_t *transaction, evrregister_t reg, uint16_t *data);
+/*Executes a transaction*/
+static	long	transactionCommit	(transaction_t *transaction);
 
 /*
  * Function definitions
@@ -108,28 +598,91 @@ evr_open(char *name)
 
 	if (!name || !strlen(name) || strlen(name) >= NAME_LENGTH)
 	{
-		printf("\x1B[31m[evr][open] Could not find device\r\n\x1B[0m");
+		evr_log("[evr][open] Could not find device\n");
 		return NULL;
 	}
 
-	for (i = 0; i < deviceCount; i++)
+	if (!bucketCount)
+		return NULL;
+
+	for (i = hash(name) & (bucketCount - 1); buckets[i]; i = (i + 1) & (bucketCount - 1))
 	{
-		if (strcmp(devices[i].name, name) == 0)
-			return &devices[i];
+		if (strcmp(buckets[i]->name, name) == 0)
+			return buckets[i];
 	}
 	return NULL;
 }
 
+/**
+ * @brief	Returns the FNV-1a hash of a device name
+ *
+ * @param	*name	:	The device name
+ * @return	The hash
+ */
+static uint32_t
+hash(const char *name)
+{
+	uint32_t	value	=	2166136261u;
+
+	for (; *name; name++)
+		value	=	(value ^ (uint8_t)*name)*16777619u;
+
+	return value;
+}
+
+/**
+ * @brief	Adds a device to the name hash table
+ *
+ * The table is doubled and rehashed whenever it becomes half full, so that lookups stay short.
+ *
+ * @param	*device	:	The device, its name must not be in the table yet
+ * @return	0 on success, -1 on failure
+ */
+static long
+insert(device_t *device)
+{
+	uint32_t	i;
+	uint32_t	j;
+	uint32_t	count;
+	device_t	**table;
+
+	if ((deviceCount + 1)*2 > bucketCount)
+	{
+		count	=	bucketCount ? bucketCount*2 : NUMBER_OF_BUCKETS;
+		table	=	calloc(count, sizeof(device_t*));
+		if (!table)
+			return -1;
+		for (i = 0; i < bucketCount; i++)
+		{
+			if (!buckets[i])
+				continue;
+			for (j = hash(buckets[i]->name) & (count - 1); table[j]; j = (j + 1) & (count - 1));
+			table[j]	=	buckets[i];
+		}
+		free(buckets);
+		buckets		=	table;
+		bucketCount	=	count;
+	}
+
+	for (i = hash(device->name) & (bucketCount - 1); buckets[i]; i = (i + 1) & (bucketCount - 1));
+	buckets[i]	=	device;
+
+	return 0;
+}
+
 /** 
  * @brief 	Initializes all configured devices
  *
  * This function is called by iocInit during IOC initialization.
- * For each configured device, this function attemps the following:
+ * Starts the reactor, then for each configured device, this function attemps the following:
  *	Initialize mutex
- *	Create and bind UDP socket
- *	Disable the device
- *	Initialize the clock
- * 	Flush event RAM
+ *	Start the worker pool
+ *	Create and bind UDP socket, and hand it to the reactor
+ *	Start bringing the device up, see starter()
+ *
+ * Host names are resolved first, concurrently, see locate().
+ * Devices are brought up concurrently. Init waits at most STARTUP_TIMEOUT for all of them,
+ * devices that are not up by then are marked offline instead of holding the IOC back.
  *
  * @return	0 on success, -1 on failure
  */
@@ -138,548 +691,1113 @@ init(void)
 {
 	int32_t				status;			
 	uint32_t			device;
+	uint32_t			i;
 	struct sockaddr_in	address;
+	struct epoll_event	event;
+	struct timespec		now;
+	struct timespec		deadline;
+	pthread_t			handle;
+	pthread_condattr_t	attributes;
+
+	initialized	=	true;
+
+	/*Initialize the state shared with the reactor*/
+	for (device = 0; device < deviceCount; device++)
+	{
+		devices[device]->rto	=	TIMEOUT*1000;
+
+		/*Start the sequence at a random point so replies meant for a previous run do not match*/
+		clock_gettime(CLOCK_REALTIME, &now);
+		devices[device]->reference	=	(now.tv_nsec ^ (now.tv_sec << 16) ^ (getpid() << 8))*(device + 1);
+	}
+
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&startupCondition, &attributes);
+
+	/*Find the addresses of the devices*/
+	locate();
+
+	/*Start the reactor*/
+	events	=	epoll_create(deviceCount + 1);
+	wakeup	=	eventfd(0, EFD_NONBLOCK);
+	if (events < 0 || wakeup < 0)
+	{
+		evr_log("[evr][init] Unable to create reactor descriptors\n");
+		return -1;
+	}
+	event.events	=	EPOLLIN;
+	event.data.ptr	=	NULL;
+	status	=	epoll_ctl(events, EPOLL_CTL_ADD, wakeup, &event);
+	if (status < 0)
+	{
+		evr_log("[evr][init] Unable to watch reactor wakeup\n");
+		return -1;
+	}
+	status	=	pthread_create(&handle, NULL, reactor, NULL);
+	if (status)
+	{
+		evr_log("[evr][init] Unable to start reactor\n");
+		return -1;
+	}
 
 	/*Initialize devices*/
 	for (device = 0; device < deviceCount; device++)
 	{
-		/*Initialize mutex*/
-		pthread_mutex_init(&devices[device].mutex, NULL);
+		/*Nothing is known about the selections yet*/
+		devices[device]->pulseSelect	=	-1;
+		devices[device]->mapSelect	=	-1;
+
+		/*Start worker pool*/
+		for (i = 0; i < NUMBER_OF_WORKERS; i++)
+		{
+			status	=	pthread_create(&handle, NULL, worker, devices[device]);
+			if (status)
+			{
+				evr_log("[evr][init] Unable to start worker\n");
+				return -1;
+			}
+		}
 
 		/*Create and initialize UDP socket*/
-		devices[device].socket 	=	socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-		if (devices[device].socket < 0)
+		devices[device]->socket 	=	socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (devices[device]->socket < 0)
 		{
-			printf("\x1B[31m[evr][init] Unable to create socket\n\x1B[0m");
+			evr_log("[evr][init] Unable to create socket\n");
 			return -1;
 		}
 		memset((uint8_t *)&address, 0, sizeof(address));
 		address.sin_family		= 	AF_INET;
-		address.sin_port 		= 	devices[device].port;
-		address.sin_addr.s_addr	=	devices[device].ip;
-		status	=	connect(devices[device].socket, (struct sockaddr*)&address, sizeof(address));
-		if (status	<	0)
+		address.sin_port 		= 	devices[device]->port;
+		address.sin_addr.s_addr	=	devices[device]->ip;
+		/*A device without an address stays offline until its starter or the tracker finds it*/
+		if (devices[device]->ip != INADDR_NONE)
 		{
-			printf("\x1B[31m[evr][init] Unable to connect to device\n\x1B[0m");
-			return -1;
+			status	=	connect(devices[device]->socket, (struct sockaddr*)&address, sizeof(address));
+			if (status	<	0)
+			{
+				evr_log("[evr][init] Unable to connect to device\n");
+				return -1;
+			}
 		}
 
-		/*
-		 * Initialize the device
-		 */
-
-		/*Disable the device*/
-		status	=	evr_enable(&devices[device], 0);
+		/*Hand the socket to the reactor*/
+		event.events	=	EPOLLIN;
+		event.data.ptr	=	devices[device];
+		status	=	epoll_ctl(events, EPOLL_CTL_ADD, devices[device]->socket, &event);
 		if (status < 0)
 		{
-			printf("\x1B[31m[evr][init] Unable to enable device\n\x1B[0m");
+			evr_log("[evr][init] Unable to watch socket\n");
 			return -1;
 		}
 
-		/*Initialize clock*/
-		status	=	evr_setClock(&devices[device], devices[device].frequency);
-		if (status < 0)
+		/*Bring the device up*/
+		pthread_mutex_lock(&devices[device]->lock);
+		devices[device]->state	=	STATE_STARTING;
+		pthread_mutex_unlock(&devices[device]->lock);
+		status	=	pthread_create(&handle, NULL, starter, devices[device]);
+		if (status)
 		{
-			printf("\x1B[31m[evr][init] Unable to set clock\n\x1B[0m");
+			evr_log("[evr][init] Unable to start device bring-up\n");
 			return -1;
 		}
+	}
 
-		/*Flush RAM*/
-		status	=	evr_flush(&devices[device]);
-		if (status < 0)
-		{
-			printf("\x1B[31m[evr][init] Unable to flush ram\n\x1B[0m");
-			return -1;
-		}
+	/*Wait for the devices to come up*/
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec		+=	STARTUP_TIMEOUT/1000;
+	deadline.tv_nsec	+=	(STARTUP_TIMEOUT%1000)*1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec	-=	1000000000;
+	}
+	pthread_mutex_lock(&startup);
+	while (started < deviceCount && pthread_cond_timedwait(&startupCondition, &startup, &deadline) != ETIMEDOUT);
+	pthread_mutex_unlock(&startup);
+
+	/*Devices still being brought up are offline until their bring-up succeeds*/
+	for (device = 0; device < deviceCount; device++)
+	{
+		pthread_mutex_lock(&devices[device]->lock);
+		if (devices[device]->state == STATE_STARTING)
+			devices[device]->state	=	STATE_OFFLINE;
+		if (devices[device]->state == STATE_OFFLINE)
+			evr_log("[evr][init] %s is offline\n", devices[device]->name);
+		pthread_mutex_unlock(&devices[device]->lock);
 	}
 
 	return 0;
 }
 
 /**
- * @brief	Enables/disables the device
+ * @brief	Disables the device, initializes its clock, flushes its event RAM and loads the mapping RAM again
  *
- * @param	*dev	:	A pointer to the device being acted upon
- * @param	enable	:	Enables the device if true, disables it if false
+ * The flush clears the mapping RAM, so the one loaded by evrLoadMap, if any, is written again.
+ *
+ * @param	*device	:	The device being brought up
  * @return	0 on success, -1 on failure
  */
-long
-evr_enable(void* dev, bool enable)
+static long
+start(device_t *device)
 {
 	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
-
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	bool		loaded;
+	uint16_t	table[NUMBER_OF_EVENTS];
 
-	/*Check inputs*/
-	if (!dev)
+	/*Disable the device*/
+	status	=	evr_enable(device, 0);
+	if (status < 0)
 	{
-		printf("\x1B[31m[evr][enable] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][start] Unable to enable %s\n", device->name);
 		return -1;
 	}
 
-	/*Act*/
-	if (enable)
+	/*Initialize clock*/
+	status	=	evr_setClock(device, device->frequency);
+	if (status < 0)
 	{
-		status	=	writereg(device, REGISTER_CONTROL, CONTROL_EVR_ENABLE | CONTROL_MAP_ENABLE);
-		if (status < 0)
-		{
-			printf("\x1B[31m[evr][enable] Couldn't write to control register\n\x1B[0m");
-			pthread_mutex_unlock(&device->mutex);
-			return -1;
-		}
+		evr_log("[evr][start] Unable to set clock of %s\n", device->name);
+		return -1;
 	}
-	else
+
+	/*Flush RAM*/
+	status	=	evr_flush(device);
+	if (status < 0)
 	{
-		status	=	writereg(device, REGISTER_CONTROL, 0);
-		if (status < 0)
-		{
-			printf("\x1B[31m[evr][enable] Couldn't write to control register\n\x1B[0m");
-			pthread_mutex_unlock(&device->mutex);
-			return -1;
-		}
+		evr_log("[evr][start] Unable to flush ram of %s\n", device->name);
+		return -1;
 	}
 
-	/*Unlock mutex*/
+	/*Load the mapping RAM again*/
+	pthread_mutex_lock(&device->mutex);
+	loaded	=	device->loaded;
+	memcpy(table, device->table, sizeof(table));
 	pthread_mutex_unlock(&device->mutex);
+	if (loaded && evr_setMapTable(device, table) < 0)
+	{
+		evr_log("[evr][start] Unable to load map of %s\n", device->name);
+		return -1;
+	}
 
 	return 0;
 }
 
 /**
- * @brief	Tests if device is enabled
+ * @brief	Checks that a device that stopped answering answers again, and whether it was reset
  *
- * @param	*dev	:	A pointer to the device being acted upon
- * @return	0 for false, 1 for true, -1 on failure
+ * The clock divider is set by start() and cleared by a reset of the device, so a device
+ * that answers with another divider lost its configuration and has to be brought up again.
+ *
+ * @param	*device	:	The device being brought back
+ * @return	0 if the device answers with its configuration, 1 if it answers after a reset, -1 if it does not answer
  */
-long
-evr_isEnabled(void* dev)
+static long
+probe(device_t *device)
 {
-	uint16_t	data	=	0;
 	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
-
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
-
-	/*Check inputs*/
-	if (!dev)
-	{
-		printf("\x1B[31m[evr][isEnabled] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
+	uint16_t	frequency;
 
-	status	=	readreg(device, REGISTER_CONTROL, &data);
+	status	=	evr_getClock(device, &frequency);
 	if (status < 0)
-	{ 
-		printf("\x1B[31m[evr][isEnabled] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+	{
+		evr_log("[evr][probe] Unable to reach %s\n", device->name);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return (data&CONTROL_EVR_ENABLE);
+	return (frequency != device->frequency) ? 1 : 0;
 }
 
 /**
- * @brief	Flushes event mapping RAM
+ * @brief	Brings a device up, then starts its status poller, event FIFO drain, data buffer receiver, timestamp sampler and shadow refresh, if configured, and its verifier
  *
- * @param	*dev	:	A pointer to the device being acted upon
- * @return	0 on success, -1 on failure
+ * A device that does not answer is marked offline, so that record requests fail at once
+ * rather than each waiting for its own timeout. It is tried again every RESTART_PERIOD until it answers.
+ * A device whose host name did not resolve has its name resolved again before every attempt.
+ * A device that stops answering once online is taken offline by transfer() and probed
+ * every RESTART_PERIOD until it answers again. Its configuration is left untouched,
+ * unless the device was reset in the meantime, in which case it is brought up again by start().
+ * Only the starter's own requests are sent while the device is starting, the others fail at once.
+ *
+ * @param	arg	:	Pointer to the device being brought up
+ * @return	NULL
  */
-long
-evr_flush(void* dev)
+static void*
+starter(void *arg)
 {
 	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
+	bool		first	=	true;
+	in_addr_t	ip;
+	char		text[INET_ADDRSTRLEN];
+	pthread_t	handle;
+	device_t	*device	=	(device_t*)arg;
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+	starting	=	true;
 
-	/*Check inputs*/
-	if (!dev)
+	while (start(device) < 0)
 	{
-		printf("\x1B[31m[evr][flush] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
+		pthread_mutex_lock(&device->lock);
+		device->state	=	STATE_OFFLINE;
+		pthread_mutex_unlock(&device->lock);
 
-	/*Act and check*/
-	status	=	writereg(device, REGISTER_CONTROL, CONTROL_FLUSH);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][flush] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
+		if (first)
+		{
+			pthread_mutex_lock(&startup);
+			started++;
+			pthread_cond_signal(&startupCondition);
+			pthread_mutex_unlock(&startup);
+			first	=	false;
+		}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+		usleep(RESTART_PERIOD*1000);
 
+		/*Retry the resolution of a device that never had an address*/
+		pthread_mutex_lock(&device->lock);
+		ip	=	device->ip;
+		pthread_mutex_unlock(&device->lock);
+		if (ip == INADDR_NONE && resolve(device->host, &ip) == 0 && relocate(device, ip) == 0)
+		{
+			evr_log("[evr][starter] %s resolved to %s\n", device->name, inet_ntop(AF_INET, &ip, text, sizeof(text)));
+			saveAddresses();
+		}
 
-	return 0;
-}
+		pthread_mutex_lock(&device->lock);
+		device->state	=	STATE_STARTING;
+		pthread_mutex_unlock(&device->lock);
+	}
 
-/**
- * @brief	Sets the frequency in MHz
- *
- * Divisor = event-frequency/1MHz. For example, at an event frequency of 125MHz, divisor = 125
- *
- * @param	*dev	:	A pointer to the device being acted upon
- * @return	0 on success, -1 on failure
- */
-long
-evr_setClock(void* dev, uint16_t frequency)
-{
-	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
+	pthread_mutex_lock(&device->lock);
+	device->state	=	STATE_ONLINE;
+	pthread_mutex_unlock(&device->lock);
+	if (!first)
+		evr_log("[evr][starter] %s is online\n", device->name);
+	else
+	{
+		pthread_mutex_lock(&startup);
+		started++;
+		pthread_cond_signal(&startupCondition);
+		pthread_mutex_unlock(&startup);
+	}
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	/*Start polling the watched registers*/
+	if (device->poll)
+	{
+		status	=	pthread_create(&handle, NULL, poller, device);
+		if (status)
+			evr_log("[evr][starter] Unable to start poller\n");
+	}
 
-	/*Check inputs*/
-	if (!dev)
+	/*Start draining the event FIFO*/
+	if (device->fifo.period)
 	{
-		printf("\x1B[31m[evr][setClock] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		status	=	pthread_create(&handle, NULL, drainer, device);
+		if (status)
+			evr_log("[evr][starter] Unable to start event FIFO drain\n");
 	}
-	if (frequency > MAX_EVENT_FREQUENCY)
+
+	/*Start receiving data buffers*/
+	if (device->data.period)
 	{
-		printf("\x1B[31m[evr][setClock] Event frequency cannot be greater than 125MHz\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		status	=	pthread_create(&handle, NULL, receiver, device);
+		if (status)
+			evr_log("[evr][starter] Unable to start data buffer receiver\n");
 	}
 
-	/*Act*/
-	status	=	writecheck(device, REGISTER_USEC_DIVIDER, frequency);
-	if (status < 0)
+	/*Start sampling the timestamp counter*/
+	if (device->timebase.period)
 	{
-		printf("\x1B[31m[evr][setClock] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		status	=	pthread_create(&handle, NULL, sampler, device);
+		if (status)
+			evr_log("[evr][starter] Unable to start timestamp sampler\n");
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	/*Start refreshing the shadow copy*/
+	if (device->refresh)
+	{
+		status	=	pthread_create(&handle, NULL, refresher, device);
+		if (status)
+			evr_log("[evr][starter] Unable to start shadow refresh\n");
+	}
 
-	return 0;
+	/*Start reading back deferred writes, the period can be configured at any time*/
+	status	=	pthread_create(&handle, NULL, verifier, device);
+	if (status)
+		evr_log("[evr][starter] Unable to start verifier\n");
+
+	/*Bring the device back whenever it stops answering, see transfer()*/
+	for (;;)
+	{
+		pthread_mutex_lock(&device->lock);
+		while (device->state != STATE_OFFLINE)
+			pthread_cond_wait(&device->lost, &device->lock);
+		pthread_mutex_unlock(&device->lock);
+
+		do
+		{
+			usleep(RESTART_PERIOD*1000);
+
+			/*Nothing learned before the device went offline can be trusted*/
+			pthread_mutex_lock(&device->lock);
+			forget(device);
+			device->state	=	STATE_STARTING;
+			pthread_mutex_unlock(&device->lock);
+
+			status	=	probe(device);
+			if (status > 0)
+			{
+				evr_log("[evr][starter] %s was reset, bringing it up again\n", device->name);
+				status	=	start(device);
+			}
+
+			pthread_mutex_lock(&device->lock);
+			device->state	=	(status < 0) ? STATE_OFFLINE : STATE_ONLINE;
+			pthread_mutex_unlock(&device->lock);
+		}
+		while (status < 0);
+
+		evr_log("[evr][starter] %s is online\n", device->name);
+	}
+
+	return NULL;
 }
 
 /**
- * @brief	Returns the set frequency in MHz
- *
- * Divisor = event-frequency/1MHz. For example, at an event frequency of 125MHz, divisor = 125
+ * @brief	Finds the address of every device
  *
- * @param	*dev		:	A pointer to the device being acted upon
- * @param	*frequency	:	The returned frequency in MHz
- * @return	0 on success, -1 on failure
+ * Host names are resolved concurrently, init waits at most RESOLVE_TIMEOUT for them.
+ * A device whose name cannot be resolved in time takes its address from the address cache file, if any,
+ * so that the IOC comes up quickly while DNS is down. The cache file is then updated,
+ * and the tracker is started if re-resolution is enabled, see evrConfigureResolver.
  */
-long
-evr_getClock(void* dev, uint16_t *frequency)
+static void
+locate(void)
 {
-	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
+	int32_t			status;
+	uint32_t		device;
+	uint32_t		count	=	0;
+	struct timespec	deadline;
+	pthread_t		handle;
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	/*Start with the cached addresses*/
+	loadAddresses();
 
-	/*Check inputs*/
-	if (!dev)
+	/*Resolve all host names at once*/
+	for (device = 0; device < deviceCount; device++)
 	{
-		printf("\x1B[31m[evr][getClock] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		devices[device]->resolved	=	INADDR_NONE;
+		status	=	pthread_create(&handle, NULL, resolver, devices[device]);
+		if (status)
+		{
+			evr_log("[evr][locate] Unable to start resolver\n");
+			continue;
+		}
+		count++;
 	}
-	if (!frequency)
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec		+=	RESOLVE_TIMEOUT/1000;
+	deadline.tv_nsec	+=	(RESOLVE_TIMEOUT%1000)*1000000;
+	if (deadline.tv_nsec >= 1000000000)
 	{
-		printf("\x1B[31m[evr][getClock] Null pointer to frequency\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		deadline.tv_sec++;
+		deadline.tv_nsec	-=	1000000000;
 	}
+	pthread_mutex_lock(&startup);
+	while (resolutions < count && pthread_cond_timedwait(&startupCondition, &startup, &deadline) != ETIMEDOUT);
 
-	/*Act*/
-	status	=	readreg(device, REGISTER_USEC_DIVIDER, frequency);
-	if (status < 0)
+	/*Resolved addresses win over cached ones, late resolutions are left to the starters and the tracker*/
+	for (device = 0; device < deviceCount; device++)
 	{
-		printf("\x1B[31m[evr][getClock] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		if (devices[device]->resolved != INADDR_NONE)
+			devices[device]->ip	=	devices[device]->resolved;
+		else if (devices[device]->ip != INADDR_NONE)
+			evr_log("[evr][locate] Unable to resolve %s, using cached address\n", devices[device]->host);
+		else
+			evr_log("[evr][locate] Unable to resolve %s\n", devices[device]->host);
 	}
+	pthread_mutex_unlock(&startup);
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	saveAddresses();
+
+	/*Follow address changes*/
+	if (resolvePeriod)
+	{
+		status	=	pthread_create(&handle, NULL, tracker, NULL);
+		if (status)
+			evr_log("[evr][locate] Unable to start tracker\n");
+	}
+}
+
+/**
+ * @brief	Resolves a host name into an IPv4 address
+ *
+ * Dotted addresses are converted without querying the resolver.
+ *
+ * @param	*host	:	The host name or dotted address
+ * @param	*ip		:	The address in network byte-order
+ * @return	0 on success, -1 on failure
+ */
+static long
+resolve(const char *host, in_addr_t *ip)
+{
+	int32_t				status;
+	struct in_addr		address;
+	struct addrinfo		hints;
+	struct addrinfo		*result;
+
+	if (inet_aton(host, &address))
+	{
+		*ip	=	address.s_addr;
+		return 0;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family		=	AF_INET;
+	hints.ai_socktype	=	SOCK_DGRAM;
+	status	=	getaddrinfo(host, NULL, &hints, &result);
+	if (status || !result)
+		return -1;
+
+	*ip	=	((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+	freeaddrinfo(result);
 
 	return 0;
 }
 
 /**
- * @brief	Enables/disables a pulser output
+ * @brief	Resolves the host name of a device during init
  *
- * Reads the enable register, calculates the new value according to the passed arguments, and writes back the new value.
+ * @param	arg	:	Pointer to the device
+ * @return	NULL
+ */
+static void*
+resolver(void *arg)
+{
+	in_addr_t	ip;
+	device_t	*device	=	(device_t*)arg;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	if (resolve(device->host, &ip) < 0)
+		ip	=	INADDR_NONE;
+
+	pthread_mutex_lock(&startup);
+	device->resolved	=	ip;
+	resolutions++;
+	pthread_cond_signal(&startupCondition);
+	pthread_mutex_unlock(&startup);
+
+	return NULL;
+}
+
+/**
+ * @brief	Periodically re-resolves the host names and reconnects devices whose address changed
+ *
+ * The socket is reconnected under the device lock, so no request is sent while the address changes.
+ * Requests in flight to the old address time out and are retransmitted to the new one.
+ *
+ * @param	arg	:	Unused
+ * @return	NULL
+ */
+static void*
+tracker(void *arg)
+{
+	uint32_t			i;
+	bool				changed;
+	bool				moved;
+	in_addr_t			ip;
+	char				text[INET_ADDRSTRLEN];
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	while (true)
+	{
+		sleep(resolvePeriod);
+
+		changed	=	false;
+		for (i = 0; i < deviceCount; i++)
+		{
+			if (resolve(devices[i]->host, &ip) < 0)
+				continue;
+
+			pthread_mutex_lock(&devices[i]->lock);
+			moved	=	(ip != devices[i]->ip);
+			pthread_mutex_unlock(&devices[i]->lock);
+			if (!moved)
+				continue;
+
+			if (relocate(devices[i], ip) < 0)
+				evr_log("[evr][tracker] Unable to reconnect %s\n", devices[i]->name);
+			else
+			{
+				changed	=	true;
+				evr_log("[evr][tracker] %s moved to %s\n", devices[i]->name, inet_ntop(AF_INET, &ip, text, sizeof(text)));
+			}
+		}
+
+		if (changed)
+			saveAddresses();
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Points the socket of a device at a new address
+ *
+ * @param	*device	:	The device being acted upon
+ * @param	ip		:	New address of the device, in network byte-order
+ * @return	0 on success, -1 on failure
+ */
+static long
+relocate(device_t *device, in_addr_t ip)
+{
+	int32_t				status;
+	struct sockaddr_in	address;
+
+	memset((uint8_t *)&address, 0, sizeof(address));
+	address.sin_family		= 	AF_INET;
+	address.sin_port 		= 	device->port;
+	address.sin_addr.s_addr	=	ip;
+
+	pthread_mutex_lock(&device->lock);
+	status	=	connect(device->socket, (struct sockaddr*)&address, sizeof(address));
+	if (status == 0)
+		device->ip	=	ip;
+	pthread_mutex_unlock(&device->lock);
+
+	return (status < 0) ? -1 : 0;
+}
+
+/**
+ * @brief	Reads the address cache file
+ *
+ * Each line holds a host name and its dotted address.
+ * Devices take the cached address of their host name until it is resolved.
+ */
+static void
+loadAddresses(void)
+{
+	uint32_t		i;
+	FILE			*file;
+	char			line[HOST_LENGTH + INET_ADDRSTRLEN + 2];
+	char			host[HOST_LENGTH];
+	char			text[INET_ADDRSTRLEN];
+	struct in_addr	address;
+
+	if (!strlen(addressFile))
+		return;
+
+	file	=	fopen(addressFile, "r");
+	if (!file)
+		return;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		if (sscanf(line, "%255s %15s", host, text) != 2 || !inet_aton(text, &address))
+			continue;
+		for (i = 0; i < deviceCount; i++)
+			if (strcmp(devices[i]->host, host) == 0)
+				devices[i]->ip	=	address.s_addr;
+	}
+
+	fclose(file);
+}
+
+/**
+ * @brief	Writes the address cache file
+ *
+ * The file is written aside and renamed over the old one, so that a crash never leaves it truncated.
+ */
+static void
+saveAddresses(void)
+{
+	uint32_t	i;
+	FILE		*file;
+	in_addr_t	ip;
+	char		name[PATH_MAX + 4];
+	char		text[INET_ADDRSTRLEN];
+
+	if (!strlen(addressFile))
+		return;
+
+	/*The tracker and the starters of unresolved devices may save at the same time*/
+	pthread_mutex_lock(&saving);
+	snprintf(name, sizeof(name), "%s.new", addressFile);
+	file	=	fopen(name, "w");
+	if (!file)
+	{
+		evr_log("[evr][saveAddresses] Unable to write %s\n", name);
+		pthread_mutex_unlock(&saving);
+		return;
+	}
+
+	for (i = 0; i < deviceCount; i++)
+	{
+		pthread_mutex_lock(&devices[i]->lock);
+		ip	=	devices[i]->ip;
+		pthread_mutex_unlock(&devices[i]->lock);
+		if (ip != INADDR_NONE)
+			fprintf(file, "%s %s\n", devices[i]->host, inet_ntop(AF_INET, &ip, text, sizeof(text)));
+	}
+
+	if (fclose(file) || rename(name, addressFile))
+		evr_log("[evr][saveAddresses] Unable to write %s\n", addressFile);
+	pthread_mutex_unlock(&saving);
+}
+
+/**
+ * @brief	Enables/disables the device
  *
  * @param	*dev	:	A pointer to the device being acted upon
- * @param	pulser	:	The pulser output being acted upon
- * @param	enable	:	Enables the output if true, disables it if false
+ * @param	enable	:	Enables the device if true, disables it if false
  * @return	0 on success, -1 on failure
  */
-long	
-evr_enablePulser(void* dev, uint8_t pulser, bool enable)
+long
+evr_enable(void* dev, bool enable)
 {
-	uint16_t	data	=	0;
 	int32_t		status;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_ENABLE);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][enablePulser] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	if (pulser >= NUMBER_OF_PULSERS)
-	{
-		printf("\x1B[31m[evr][enablePulser] Pulser must be 0-13\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enable] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 
-	/*Get pulser status*/
-	status	=	readreg(device, REGISTER_PULSE_ENABLE, &data);
-	if (status < 0)
+	/*Act*/
+	if (enable)
 	{
-		printf("\x1B[31m[evr][enablePulser] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		status	=	writereg(device, REGISTER_CONTROL, CONTROL_EVR_ENABLE | CONTROL_MAP_ENABLE);
+		if (status < 0)
+		{
+			evr_log("[evr][enable] Couldn't write to control register\n");
+			release(device);
+			return -1;
+		}
 	}
-
-	/*Prepare pulser status*/
-	if (enable)
-		data	|=	(1<<pulser);
 	else
-		data	&=	~(1<<pulser);
-
-	/*Update pulser status*/
-	status	=	writecheck(device, REGISTER_PULSE_ENABLE, data);
-	if (status < 0)
 	{
-		printf("\x1B[31m[evr][enablePulser] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		status	=	writereg(device, REGISTER_CONTROL, 0);
+		if (status < 0)
+		{
+			evr_log("[evr][enable] Couldn't write to control register\n");
+			release(device);
+			return -1;
+		}
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
- * @brief	Checks if pulser is enabled
+ * @brief	Tests if device is enabled
  *
  * @param	*dev	:	A pointer to the device being acted upon
- * @param	pulser	:	The pulser output being acted upon
- * @return	1 if true, 0 if false, -1 on failure
+ * @return	0 for false, 1 for true, -1 on failure
  */
-long	
-evr_isPulserEnabled	(void* dev, uint8_t pulser)
+long
+evr_isEnabled(void* dev)
 {
 	uint16_t	data	=	0;
 	int32_t		status;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_IS_ENABLED);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][isPulserEnabled] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	if (pulser >= NUMBER_OF_PULSERS)
-	{
-		printf("\x1B[31m[evr][isPulserEnabled] Pulser must be 0-13\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][isEnabled] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 
-	/*Get pulser status*/
-	status	=	readreg(device, REGISTER_PULSE_ENABLE, &data);
+	status	=	readreg(device, REGISTER_CONTROL, &data);
 	if (status < 0)
-	{
-		printf("\x1B[31m[evr][isPulserEnabled] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+	{ 
+		evr_log("[evr][isEnabled] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
 	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	release(device);
 
-	return (data&(1<<pulser));
+	return (data&CONTROL_EVR_ENABLE);
 }
 
 /**
- * @brief	Sets pulser delay
- *
- * Converts pulser delay from microseconds to clock cycles then writes the value to the delay register of the pulser.
- * Maximum delay in microseconds = 2^32/event_frequency in MHz.
- * For example, @F = 125MHz, Maximum delay = 34.4s (34.4e6 microseconds)
+ * @brief	Flushes event mapping RAM
  *
  * @param	*dev	:	A pointer to the device being acted upon
- * @param	pulser	:	The pulser being acted upon
- * @param	delay	:	The delay, in microseconds, of the pulser specified in the second argument
  * @return	0 on success, -1 on failure
  */
-long	
-evr_setPulserDelay(void* dev, uint8_t pulser, float delay)
+long
+evr_flush(void* dev)
 {
-	uint32_t	cycles;
 	int32_t		status;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_FLUSH);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setPulserDelay] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	if (pulser >= NUMBER_OF_PULSERS)
-	{
-		printf("\x1B[31m[evr][setPulserDelay] Pulser must be 0-13\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	if (delay < 0 || delay > (UINT_MAX/device->frequency))
-	{
-		printf("\x1B[31m[evr][setPulserDelay] Delay must be less than %f microseconds\n\x1B[0m", (UINT_MAX/(double)device->frequency));
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][flush] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 
-	/*Convert pulser delay*/
-	cycles	=	delay*device->frequency;	
-
-	/*Select pulser*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT,	pulser + PULSE_SELECT_OFFSET);
+	/*Act and check*/
+	status	=	writereg(device, REGISTER_CONTROL, CONTROL_FLUSH);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPulserDelay] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][flush] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Write new delay*/
-	status	=	writecheck(device, REGISTER_PULSE_DELAY, cycles>>16);
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Sets the frequency in MHz
+ *
+ * Divisor = event-frequency/1MHz. For example, at an event frequency of 125MHz, divisor = 125
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_setClock(void* dev, uint16_t frequency)
+{
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_SET_CLOCK);
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][setClock] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+	if (frequency > MAX_EVENT_FREQUENCY)
+	{
+		evr_log("[evr][setClock] Event frequency cannot be greater than 125MHz\n");
+		release(device);
+		return -1;
+	}
+
+	/*Act*/
+	status	=	writecheck(device, REGISTER_USEC_DIVIDER, frequency);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPulserDelay] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setClock] Couldn't write to register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Returns the set frequency in MHz
+ *
+ * Divisor = event-frequency/1MHz. For example, at an event frequency of 125MHz, divisor = 125
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	*frequency	:	The returned frequency in MHz
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getClock(void* dev, uint16_t *frequency)
+{
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_GET_CLOCK);
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][getClock] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
-	status	=	writecheck(device, REGISTER_PULSE_DELAY+2, cycles);
+	if (!frequency)
+	{
+		evr_log("[evr][getClock] Null pointer to frequency\n");
+		release(device);
+		return -1;
+	}
+
+	/*Act*/
+	status	=	readreg(device, REGISTER_USEC_DIVIDER, frequency);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPulserDelay] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getClock] Couldn't read register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Enables/disables a pulser output
+ *
+ * Reads the enable register, calculates the new value according to the passed arguments, and writes back the new value.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	pulser	:	The pulser output being acted upon
+ * @param	enable	:	Enables the output if true, disables it if false
+ * @return	0 on success, -1 on failure
+ */
+long	
+evr_enablePulser(void* dev, uint8_t pulser, bool enable)
+{
+	uint16_t	data	=	0;
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_ENABLE_PULSER);
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][enablePulser] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+	if (pulser >= NUMBER_OF_PULSERS)
+	{
+		evr_log("[evr][enablePulser] Pulser must be 0-13\n");
+		release(device);
+		return -1;
+	}
+
+	/*Get pulser status*/
+	status	=	readreg(device, REGISTER_PULSE_ENABLE, &data);
+	if (status < 0)
+	{
+		evr_log("[evr][enablePulser] Couldn't read register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Prepare pulser status*/
+	if (enable)
+		data	|=	(1<<pulser);
+	else
+		data	&=	~(1<<pulser);
+
+	/*Update pulser status*/
+	status	=	writecheck(device, REGISTER_PULSE_ENABLE, data);
+	if (status < 0)
+	{
+		evr_log("[evr][enablePulser] Couldn't write to register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Checks if pulser is enabled
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	pulser	:	The pulser output being acted upon
+ * @return	1 if true, 0 if false, -1 on failure
+ */
+long	
+evr_isPulserEnabled	(void* dev, uint8_t pulser)
+{
+	uint16_t	data	=	0;
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_IS_PULSER_ENABLED);
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][isPulserEnabled] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+	if (pulser >= NUMBER_OF_PULSERS)
+	{
+		evr_log("[evr][isPulserEnabled] Pulser must be 0-13\n");
+		release(device);
+		return -1;
+	}
+
+	/*Get pulser status*/
+	status	=	readreg(device, REGISTER_PULSE_ENABLE, &data);
+	if (status < 0)
+	{
+		evr_log("[evr][isPulserEnabled] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
 	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	release(device);
 
-	return 0;
+	return (data&(1<<pulser));
 }
 
 /**
- * @brief	Gets pulser delay
+ * @brief	Sets pulser delay
  *
- * Reads pulser delay and converts it from clock cycles to microseconds.
+ * Converts pulser delay from microseconds to clock cycles then writes the value to the delay register of the pulser.
+ * Maximum delay in microseconds = 2^32/event_frequency in MHz.
+ * For example, @F = 125MHz, Maximum delay = 34.4s (34.4e6 microseconds)
  *
  * @param	*dev	:	A pointer to the device being acted upon
  * @param	pulser	:	The pulser being acted upon
- * @param	*delay	:	The delay, in microseconds, of the pulser
+ * @param	delay	:	The delay, in microseconds, of the pulser specified in the second argument
  * @return	0 on success, -1 on failure
  */
 long	
-evr_getPulserDelay(void* dev, uint8_t pulser, double *delay)
+evr_setPulserDelay(void* dev, uint8_t pulser, float delay)
 {
-	uint16_t	data	=	0;
-	uint32_t	cycles; int32_t		status;
+	uint32_t	cycles;
+	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_PULSER_DELAY);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getPulserDelay] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserDelay] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pulser >= NUMBER_OF_PULSERS)
 	{
-		printf("\x1B[31m[evr][getPulserDelay] Pulser must be 0-13\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserDelay] Pulser must be 0-13\n");
+		release(device);
 		return -1;
 	}
-	if (!delay)
+	if (delay < 0 || delay > (UINT_MAX/device->frequency))
 	{
-		printf("\x1B[31m[evr][getPulserDelay] Null pointer to delay\r\n");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserDelay] Delay must be less than %f microseconds\n", (UINT_MAX/(double)device->frequency));
+		release(device);
 		return -1;
 	}
 
-	/*Select pulser*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT,	pulser + PULSE_SELECT_OFFSET);
+	/*Convert pulser delay*/
+	cycles	=	delay*device->frequency;	
+
+	/*Select pulser and write new delay*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pulser + PULSE_SELECT_OFFSET);
+	transactionWrite(&transaction, REGISTER_PULSE_DELAY, cycles>>16, true);
+	transactionWrite(&transaction, REGISTER_PULSE_DELAY+2, cycles, true);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getPulserDelay] Unable to select pulser.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserDelay] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Read delay*/
-	status	=	readreg(device, REGISTER_PULSE_DELAY, &data);
-	if (status < 0)
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Gets pulser delay
+ *
+ * Reads pulser delay and converts it from clock cycles to microseconds.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	pulser	:	The pulser being acted upon
+ * @param	*delay	:	The delay, in microseconds, of the pulser
+ * @return	0 on success, -1 on failure
+ */
+long	
+evr_getPulserDelay(void* dev, uint8_t pulser, double *delay)
+{
+	uint16_t	high;
+	uint16_t	low;
+	uint32_t	cycles;
+	int32_t		status;
+	transaction_t	transaction;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_GET_PULSER_DELAY);
+
+	/*Check inputs*/
+	if (!dev)
 	{
-		printf("\x1B[31m[evr][getPulserDelay] Unable to read delay.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPulserDelay] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+	if (pulser >= NUMBER_OF_PULSERS)
+	{
+		evr_log("[evr][getPulserDelay] Pulser must be 0-13\n");
+		release(device);
+		return -1;
+	}
+	if (!delay)
+	{
+		evr_log("[evr][getPulserDelay] Null pointer to delay\n");
+		release(device);
 		return -1;
 	}
-	cycles	=	data;
-	cycles	<<=	16;
 
-	status	=	readreg(device, REGISTER_PULSE_DELAY+2, &data);
+	/*Select pulser and read delay*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pulser + PULSE_SELECT_OFFSET);
+	transactionRead(&transaction, REGISTER_PULSE_DELAY, &high);
+	transactionRead(&transaction, REGISTER_PULSE_DELAY+2, &low);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getPulserDelay] Unable to read delay.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPulserDelay] Unable to read delay.\n");
+		release(device);
 		return -1;
 	}
-	cycles	|=	data;
+	cycles	=	high;
+	cycles	<<=	16;
+	cycles	|=	low;
 
 	/*Convert pulser delay*/
 	*delay	=	cycles/(double)device->frequency;	
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -699,56 +1817,49 @@ evr_setPulserWidth(void* dev, uint8_t pulser, float width)
 {
 	uint16_t	cycles;
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_PULSER_WIDTH);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setPulserWidth] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserWidth] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pulser >= NUMBER_OF_PULSERS)
 	{
-		printf("\x1B[31m[evr][setPulserWidth] Pulser must be 0-13\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserWidth] Pulser must be 0-13\n");
+		release(device);
 		return -1;
 	}
 	if (width < 0 || width > (USHRT_MAX/device->frequency))
 	{
-		printf("\x1B[31m[evr][setPulserWidth] Width must be less than %f microseconds\n\x1B[0m", (USHRT_MAX/(double)device->frequency));
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserWidth] Width must be less than %f microseconds\n", (USHRT_MAX/(double)device->frequency));
+		release(device);
 		return -1;
 	}
 
 	/*Convert pulser delay*/
 	cycles	=	width*device->frequency;	
 
-	/*Select pulser*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT,	pulser + PULSE_SELECT_OFFSET);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setPulserWidth] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Write new width*/
-	status	=	writecheck(device, REGISTER_PULSE_WIDTH+2, cycles);
+	/*Select pulser and write new width*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pulser + PULSE_SELECT_OFFSET);
+	transactionWrite(&transaction, REGISTER_PULSE_WIDTH+2, cycles, true);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPulserWidth] Couldn't write to regster\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPulserWidth] Couldn't write to regster\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -766,56 +1877,49 @@ evr_getPulserWidth(void* dev, uint8_t pulser, double *width)
 {
 	uint16_t	cycles;
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_PULSER_WIDTH);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getPulserWidth] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPulserWidth] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pulser >= NUMBER_OF_PULSERS)
 	{
-		printf("\x1B[31m[evr][getPulserWidth] Pulser must be 0-13\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPulserWidth] Pulser must be 0-13\n");
+		release(device);
 		return -1;
 	}
 	if (!width)
 	{
-		printf("\x1B[31m[evr][getPulserWidth] Null pointer to width\r\n");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select pulser*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT,	pulser + PULSE_SELECT_OFFSET);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getPulserWidth] Unable to select pulser.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPulserWidth] Null pointer to width\n");
+		release(device);
 		return -1;
 	}
 
-	/*Read width*/
-	status	=	readreg(device, REGISTER_PULSE_WIDTH+2, &cycles);
+	/*Select pulser and read width*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pulser + PULSE_SELECT_OFFSET);
+	transactionRead(&transaction, REGISTER_PULSE_WIDTH+2, &cycles);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getPulserWidth] Unable to read width.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPulserWidth] Unable to read width.\n");
+		release(device);
 		return -1;
 	}
 
 	/*Convert pulser delay*/
 	*width	=	cycles/(double)device->frequency;	
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -836,19 +1940,19 @@ evr_enablePdp(void* dev, uint8_t pdp, bool enable)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_ENABLE_PDP);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][enablePdp] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enablePdp] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][enablePdp] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enablePdp] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 
@@ -856,8 +1960,8 @@ evr_enablePdp(void* dev, uint8_t pdp, bool enable)
 	status	=	readreg(device, REGISTER_PDP_ENABLE, &data);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][enablePdp] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enablePdp] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
@@ -871,15 +1975,13 @@ evr_enablePdp(void* dev, uint8_t pdp, bool enable)
 	status	=	writecheck(device, REGISTER_PDP_ENABLE, data);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][enablePdp] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enablePdp] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -897,19 +1999,19 @@ evr_isPdpEnabled(void* dev, uint8_t pdp)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_IS_PDP_ENABLED);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][isPdpEnabled] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][isPdpEnabled] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][isPdpEnabled] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][isPdpEnabled] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 
@@ -917,13 +2019,13 @@ evr_isPdpEnabled(void* dev, uint8_t pdp)
 	status	=	readreg(device, REGISTER_PDP_ENABLE, &data);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][isPdpEnabled] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][isPdpEnabled] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
 	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	release(device);
 
 	return (data&(1<<pdp));
 }
@@ -940,47 +2042,40 @@ long
 evr_setPdpPrescaler(void* dev, uint8_t pdp, uint16_t prescaler)
 {
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_PDP_PRESCALER);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setPdpPrescaler] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpPrescaler] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][setPdpPrescaler] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select pdp*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT, pdp);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setPdpPrescaler] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpPrescaler] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 
-	/*Write new prescaler*/
-	status	=	writecheck(device, REGISTER_PULSE_PRESCALAR, prescaler);
+	/*Select pdp and write new prescaler*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pdp);
+	transactionWrite(&transaction, REGISTER_PULSE_PRESCALAR, prescaler, true);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPdpPrescaler] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpPrescaler] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -995,53 +2090,46 @@ long
 evr_getPdpPrescaler(void* dev, uint8_t pdp, uint16_t *prescaler)
 {
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_PDP_PRESCALER);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getPdpPrescaler] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpPrescaler] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][getPdpPrescaler] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpPrescaler] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 	if (!prescaler)
 	{
-		printf("\x1B[31m[evr][getPdpPrescaler] Null pointer to prescaler\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select pdp*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT, pdp);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getPdpPrescaler] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpPrescaler] Null pointer to prescaler\n");
+		release(device);
 		return -1;
 	}
 
-	/*Read prescalar*/
-	status	=	readreg(device, REGISTER_PULSE_PRESCALAR, prescaler);
+	/*Select pdp and read prescalar*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pdp);
+	transactionRead(&transaction, REGISTER_PULSE_PRESCALAR, prescaler);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getPdpPrescaler] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpPrescaler] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1063,72 +2151,61 @@ evr_setPdpDelay(void* dev, uint8_t pdp, float delay)
 	uint16_t	prescaler;	
 	uint32_t	cycles;
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_PDP_DELAY);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setPdpDelay] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpDelay] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][setPdpDelay] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpDelay] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 	if (delay < 0 || delay > (UINT_MAX/device->frequency))
 	{
-		printf("\x1B[31m[evr][setPdpDelay] Delay must be less than %f microseconds\n\x1B[0m", (UINT_MAX/(double)device->frequency));
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select pdp*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT, pdp);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setPdpDelay] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpDelay] Delay must be less than %f microseconds\n", (UINT_MAX/(double)device->frequency));
+		release(device);
 		return -1;
 	}
 
-	/*Read prescaler*/
-	status	=	readreg(device, REGISTER_PULSE_PRESCALAR, &prescaler);
+	/*Select pdp and read prescaler*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pdp);
+	transactionRead(&transaction, REGISTER_PULSE_PRESCALAR, &prescaler);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPdpDelay] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpDelay] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
 	/*Convert pdp delay*/
 	cycles	=	delay*device->frequency/prescaler;	
 
-	/*Write new delay*/
-	status	=	writecheck(device, REGISTER_PULSE_DELAY, cycles>>16);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setPdpDelay] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	status	=	writecheck(device, REGISTER_PULSE_DELAY+2, cycles);
+	/*Write new delay, the pdp is still selected*/
+	transactionBegin(&transaction, device);
+	transactionWrite(&transaction, REGISTER_PULSE_DELAY, cycles>>16, true);
+	transactionWrite(&transaction, REGISTER_PULSE_DELAY+2, cycles, true);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPdpDelay] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpDelay] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1146,79 +2223,58 @@ long
 evr_getPdpDelay(void* dev, uint8_t pdp, double *delay)
 {
 	uint16_t	prescaler;
-	uint16_t	data;
+	uint16_t	high;
+	uint16_t	low;
 	uint32_t	cycles;
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_PDP_DELAY);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getPdpDelay] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpDelay] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][getPdpDelay] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpDelay] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 	if (!delay)
 	{
-		printf("\x1B[31m[evr][getPdpDelay] Null pointer to delay\r\n");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select pdp*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT, pdp);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getPdpDelay] Unable to select pulser.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Read prescaler*/
-	status	=	readreg(device, REGISTER_PULSE_PRESCALAR, &prescaler);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getPdpDelay] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpDelay] Null pointer to delay\n");
+		release(device);
 		return -1;
 	}
 
-	/*Read delay*/
-	status	=	readreg(device, REGISTER_PULSE_DELAY, &data);
+	/*Select pdp and read prescaler and delay*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pdp);
+	transactionRead(&transaction, REGISTER_PULSE_PRESCALAR, &prescaler);
+	transactionRead(&transaction, REGISTER_PULSE_DELAY, &high);
+	transactionRead(&transaction, REGISTER_PULSE_DELAY+2, &low);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getPdpDelay] Unable to read delay.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpDelay] Unable to read delay.\n");
+		release(device);
 		return -1;
 	}
-	cycles	=	data;
+	cycles	=	high;
 	cycles	<<=	16;
-
-	status	=	readreg(device, REGISTER_PULSE_DELAY+2, &data);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getPdpDelay] Unable to read delay.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	cycles	|=	data;
+	cycles	|=	low;
 
 	/*Convert delay*/
 	*delay	=	prescaler*cycles/(double)device->frequency;	
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1240,72 +2296,61 @@ evr_setPdpWidth(void* dev, uint8_t pdp, float width)
 	uint16_t	prescaler;
 	uint32_t	cycles;
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_PDP_WIDTH);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setPdpWidth] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpWidth] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][setPdpWidth] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpWidth] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 	if (width < 0 || width > (UINT_MAX/device->frequency))
 	{
-		printf("\x1B[31m[evr][setPdpWidth] Width must be less than %f microseconds\n\x1B[0m", (UINT_MAX/(double)device->frequency));
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select pdp*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT, pdp);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setPdpWidth] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpWidth] Width must be less than %f microseconds\n", (UINT_MAX/(double)device->frequency));
+		release(device);
 		return -1;
 	}
 
-	/*Read prescaler*/
-	status	=	readreg(device, REGISTER_PULSE_PRESCALAR, &prescaler);
+	/*Select pdp and read prescaler*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pdp);
+	transactionRead(&transaction, REGISTER_PULSE_PRESCALAR, &prescaler);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPdpWidth] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpWidth] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
 	/*Convert pdp delay*/
 	cycles	=	width*device->frequency/prescaler;	
 
-	/*Write new width*/
-	status	=	writecheck(device, REGISTER_PULSE_WIDTH, cycles>>16);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setPdpWidth] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	status	=	writecheck(device, REGISTER_PULSE_WIDTH+2, cycles);
+	/*Write new width, the pdp is still selected*/
+	transactionBegin(&transaction, device);
+	transactionWrite(&transaction, REGISTER_PULSE_WIDTH, cycles>>16, true);
+	transactionWrite(&transaction, REGISTER_PULSE_WIDTH+2, cycles, true);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPdpWidth] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpWidth] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1322,79 +2367,58 @@ long
 evr_getPdpWidth(void* dev, uint8_t pdp, double *width)
 {
 	uint16_t	prescaler;
-	uint16_t	data;
+	uint16_t	high;
+	uint16_t	low;
 	uint32_t	cycles;
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_PDP_WIDTH);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getPdpWidth] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpWidth] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (pdp >= NUMBER_OF_PDP)
 	{
-		printf("\x1B[31m[evr][getPdpWidth] Pdp must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpWidth] Pdp must be 0-3\n");
+		release(device);
 		return -1;
 	}
 	if (!width)
 	{
-		printf("\x1B[31m[evr][getPdpWidth] Null pointer to delay\r\n");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select pdp*/
-	status	=	writecheck(device, REGISTER_PULSE_SELECT, pdp);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getPdpWidth] Unable to select pulser.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Read prescaler*/
-	status	=	readreg(device, REGISTER_PULSE_PRESCALAR, &prescaler);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setPdpPrescaler] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpWidth] Null pointer to delay\n");
+		release(device);
 		return -1;
 	}
 
-	/*Read width*/
-	status	=	readreg(device, REGISTER_PULSE_WIDTH, &data);
+	/*Select pdp and read prescaler and width*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_PULSE_SELECT, pdp);
+	transactionRead(&transaction, REGISTER_PULSE_PRESCALAR, &prescaler);
+	transactionRead(&transaction, REGISTER_PULSE_WIDTH, &high);
+	transactionRead(&transaction, REGISTER_PULSE_WIDTH+2, &low);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getPdpWidth] Unable to read width.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getPdpWidth] Unable to read width.\n");
+		release(device);
 		return -1;
 	}
-	cycles	=	data;
+	cycles	=	high;
 	cycles	<<=	16;
+	cycles	|=	low;
 
-	status	=	readreg(device, REGISTER_PULSE_WIDTH+2, &data);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getPdpWidth] Unable to read width.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-	cycles	|=	data;
-
-	/*Convert pulser width*/
+	/*Convert width*/
 	*width	=	prescaler*cycles/(double)device->frequency;	
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1412,23 +2436,23 @@ evr_enableCml(void* dev, uint8_t cml, bool enable)
 	int32_t		status;
 	device_t	*device	=	(device_t*)dev;
 
+	/*Lock mutex*/
+	acquire(device, API_ENABLE_CML);
+
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][enableCml] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enableCml] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (cml >= NUMBER_OF_CML)
 	{
-		printf("\x1B[31m[evr][enableCml] Cml must be 0-2\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enableCml] Cml must be 0-2\n");
+		release(device);
 		return -1;
 	}
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
-
 	if (enable)
 		data	=	CML_FREQUENCY_MODE + CML_ENABLE;
 	else
@@ -1438,15 +2462,13 @@ evr_enableCml(void* dev, uint8_t cml, bool enable)
 	status	=	writecheck(device, REGISTER_CML4_ENABLE + (cml*0x20), data);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][enableCml] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][enableCml] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1464,19 +2486,19 @@ evr_isCmlEnabled(void* dev, uint8_t cml)
 	device_t*	device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_IS_CML_ENABLED);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][isCmlEnabled] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][isCmlEnabled] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (cml >= NUMBER_OF_CML)
 	{
-		printf("\x1B[31m[evr][isCmlEnabled] Cml must be 0-2\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][isCmlEnabled] Cml must be 0-2\n");
+		release(device);
 		return -1;
 	}
 
@@ -1484,13 +2506,13 @@ evr_isCmlEnabled(void* dev, uint8_t cml)
 	status	=	readreg(device, REGISTER_CML4_ENABLE + (cml*0x20), &data);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][isCmlEnabled] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][isCmlEnabled] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
 	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	release(device);
 
 	return (data&CML_ENABLE);
 }
@@ -1510,19 +2532,19 @@ evr_setCmlPrescaler(void* dev, uint8_t cml, uint32_t prescaler)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_CML_PRESCALER);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setCmlPrescaler] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setCmlPrescaler] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (cml >= NUMBER_OF_CML)
 	{
-		printf("\x1B[31m[evr][setCmlPrescaler] Cml must be 0-2\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setCmlPrescaler] Cml must be 0-2\n");
+		release(device);
 		return -1;
 	}
 
@@ -1530,22 +2552,20 @@ evr_setCmlPrescaler(void* dev, uint8_t cml, uint32_t prescaler)
 	status	=	writecheck(device, REGISTER_CML4_HP + (cml*0x20), prescaler/2);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setCmlPrescaler] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setCmlPrescaler] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 	status	=	writecheck(device, REGISTER_CML4_LP + (cml*0x20), prescaler - (prescaler/2));
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setCmlPrescaler] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setCmlPrescaler] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1564,25 +2584,25 @@ evr_getCmlPrescaler(void* dev, uint8_t cml, uint32_t *prescaler)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_CML_PRESCALER);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getCmlPrescaler] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getCmlPrescaler] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (cml >= NUMBER_OF_CML)
 	{
-		printf("\x1B[31m[evr][getCmlPrescaler] Cml must be 0-2\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getCmlPrescaler] Cml must be 0-2\n");
+		release(device);
 		return -1;
 	}
 	if (!prescaler)
 	{
-		printf("\x1B[31m[evr][getCmlPrescaler] Null pointer to prescaler\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getCmlPrescaler] Null pointer to prescaler\n");
+		release(device);
 		return -1;
 	}
 
@@ -1590,8 +2610,8 @@ evr_getCmlPrescaler(void* dev, uint8_t cml, uint32_t *prescaler)
 	status	=	readreg(device, REGISTER_CML4_HP + (cml*0x20), &data);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getCmlPrescaler] Unable to read prescaler.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getCmlPrescaler] Unable to read prescaler.\n");
+		release(device);
 		return -1;
 	}
 	*prescaler	=	data;
@@ -1599,16 +2619,14 @@ evr_getCmlPrescaler(void* dev, uint8_t cml, uint32_t *prescaler)
 	status	=	readreg(device, REGISTER_CML4_LP + (cml*0x20), &data);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getCmlPrescaler] Unable to read prescaler.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getCmlPrescaler] Unable to read prescaler.\n");
+		release(device);
 		return -1;
 	}
 	*prescaler	+=	data;
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1623,41 +2641,34 @@ long
 evr_setMap(void* dev, uint8_t event, uint16_t map)
 {
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_MAP);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setMap] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select event*/
-	status	=	writecheck(device, REGISTER_MAP_ADDRESS, event);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][setMap] Couldn't write register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setMap] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 
-	/*Write event actions*/
-	status	=	writecheck(device, REGISTER_MAP_DATA, map);
+	/*Select event and write event actions*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_MAP_ADDRESS, event);
+	transactionWrite(&transaction, REGISTER_MAP_DATA, map, true);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setMap] Couldn't write register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setMap] Couldn't write register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1672,133 +2683,285 @@ long
 evr_getMap(void* dev, uint8_t event, uint16_t *map)
 {
 	int32_t		status;
+	transaction_t	transaction;
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_MAP);
 
 	/*Check inputs*/
 	if (!dev || !map)
 	{
-		printf("\x1B[31m[evr][setPdpPrescaler] Null pointers\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
-	}
-
-	/*Select event*/
-	status	=	writecheck(device, REGISTER_MAP_ADDRESS, event);
-	if (status < 0)
-	{
-		printf("\x1B[31m[evr][getMap] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setPdpPrescaler] Null pointers\n");
+		release(device);
 		return -1;
 	}
 
-	/*Read event actions*/
-	status	=	readreg(device, REGISTER_MAP_DATA, map);
+	/*Select event and read event actions*/
+	transactionBegin(&transaction, device);
+	transactionSelect(&transaction, REGISTER_MAP_ADDRESS, event);
+	transactionRead(&transaction, REGISTER_MAP_DATA, map);
+	status	=	transactionCommit(&transaction);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setMap] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getMap] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
- * @brief	Sets selected prescalar
+ * @brief	Maps all events to actions at once
  *
- * @param	*dev		:	A pointer to the device being acted upon
- * @param	select		:	Prescalar to be set (0, 1, or 2)
- * @param	prescalar	:	Value of prescalar
+ * Every entry is selected, written and read back within a single call. The mapping RAM is only reachable
+ * through REGISTER_MAP_ADDRESS, which is a barrier, and the write and read-back of REGISTER_MAP_DATA are kept
+ * in order, so every entry costs three round trips, no fewer than separate evr_setMap calls.
+ * If the cache is enabled (see evrConfigureCache), entries whose shadow copy is recent enough and already
+ * hold the new actions are skipped, so only the events that change are paid for.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*table	:	The actions of each event, NUMBER_OF_EVENTS entries indexed by event
  * @return	0 on success, -1 on failure
  */
-long	
-evr_setPrescaler(void* dev, uint8_t select, uint16_t prescaler)
+long
+evr_setMapTable(void* dev, uint16_t *table)
 {
+	uint32_t	i;
+	uint32_t	count		=	0;
+	int32_t		selected;
 	int32_t		status;
+	request_t	*requests;
 	device_t	*device	=	(device_t*)dev;
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
-
 	/*Check inputs*/
-	if (!dev)
+	if (!dev || !table)
 	{
-		printf("\x1B[31m[evr][setPrescaler] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setMapTable] Null pointers\n");
 		return -1;
 	}
-	if (select >= NUMBER_OF_PRESCALERS)
+
+	requests	=	calloc(NUMBER_OF_EVENTS*3, sizeof(request_t));
+	if (!requests)
 	{
-		printf("\x1B[31m[evr][setPrescaler] select must be 0-2\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setMapTable] Unable to allocate requests\n");
 		return -1;
 	}
 
-	/*Write new prescalar*/
-	status	=	writecheck(device, REGISTER_PRESCALAR_0+(select*2), prescaler);
+	/*Lock mutex*/
+	acquire(device, API_SET_MAP_TABLE);
+
+	/*Select, write and read back every event, skipping the ones the cache knows to be unchanged*/
+	selected	=	device->mapSelect;
+	for (i = 0; i < NUMBER_OF_EVENTS; i++)
+	{
+		if (fresh(&device->map[i], device->age) && device->map[i].data == table[i])
+			continue;
+		if (selected != (int32_t)i)
+		{
+			requests[count].access	=	ACCESS_WRITE;
+			requests[count].reg		=	REGISTER_MAP_ADDRESS;
+			requests[count].data	=	i;
+			count++;
+			selected				=	i;
+		}
+		requests[count].access	=	ACCESS_WRITE;
+		requests[count].reg		=	REGISTER_MAP_DATA;
+		requests[count].data	=	table[i];
+		count++;
+		requests[count].access	=	ACCESS_READ;
+		requests[count].reg		=	REGISTER_MAP_DATA;
+		count++;
+	}
+
+	status	=	transfer(device, requests, count);
+	for (i = 1; i < count; i++)
+	{
+		if (requests[i].access == ACCESS_READ && requests[i].data != requests[i-1].data)
+			status	=	-1;
+	}
+	free(requests);
+
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPrescaler] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setMapTable] Couldn't write mapping RAM\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
- * @brief	Reads selected prescalar
+ * @brief	Reads the actions of all events at once
  *
- * @param	*dev		:	A pointer to the device being acted upon
- * @param	select		:	Prescalar to be set (0, 1, or 2)
- * @param	*prescalar	:	Value of prescalar
+ * Entries are answered from the shadow copy if the cache allows it, the others are
+ * selected and read from the device, two round trips per entry, see evr_setMapTable.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*table	:	The actions of each event, NUMBER_OF_EVENTS entries indexed by event
  * @return	0 on success, -1 on failure
  */
-long	
-evr_getPrescaler(void* dev, uint8_t select, uint16_t *prescaler)
+long
+evr_getMapTable(void* dev, uint16_t *table)
 {
+	uint32_t	i;
+	uint32_t	count		=	0;
+	int32_t		selected;
 	int32_t		status;
+	int32_t		index[NUMBER_OF_EVENTS];
+	request_t	*requests;
 	device_t	*device	=	(device_t*)dev;
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
-
-	/*Check selection*/
-	if (!dev)
+	/*Check inputs*/
+	if (!dev || !table)
 	{
-		printf("\x1B[31m[evr][setPrescaler] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getMapTable] Null pointers\n");
 		return -1;
 	}
-	if (select >= NUMBER_OF_PRESCALERS)
+
+	requests	=	calloc(NUMBER_OF_EVENTS*2, sizeof(request_t));
+	if (!requests)
 	{
-		printf("\x1B[31m[evr][setPrescaler] select must be 0-2\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getMapTable] Unable to allocate requests\n");
 		return -1;
 	}
 
-	/*Read prescaler*/
-	status	=	readreg(device, REGISTER_PRESCALAR_0+(select*2), prescaler);
+	/*Lock mutex*/
+	acquire(device, API_GET_MAP_TABLE);
+
+	/*Select and read every event that cannot be answered from the shadow copy*/
+	selected	=	device->mapSelect;
+	for (i = 0; i < NUMBER_OF_EVENTS; i++)
+	{
+		index[i]	=	-1;
+		if (fresh(&device->map[i], device->age))
+		{
+			table[i]	=	device->map[i].data;
+			continue;
+		}
+		if (selected != (int32_t)i)
+		{
+			requests[count].access	=	ACCESS_WRITE;
+			requests[count].reg		=	REGISTER_MAP_ADDRESS;
+			requests[count].data	=	i;
+			count++;
+			selected				=	i;
+		}
+		index[i]				=	count;
+		requests[count].access	=	ACCESS_READ;
+		requests[count].reg		=	REGISTER_MAP_DATA;
+		count++;
+	}
+
+	status	=	transfer(device, requests, count);
+	for (i = 0; i < NUMBER_OF_EVENTS; i++)
+	{
+		if (index[i] >= 0)
+			table[i]	=	requests[index[i]].data;
+	}
+	free(requests);
+
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setPrescaler] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getMapTable] Couldn't read mapping RAM\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
 
-	return 0;
+/**
+ * @brief	Sets selected prescalar
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	select		:	Prescalar to be set (0, 1, or 2)
+ * @param	prescalar	:	Value of prescalar
+ * @return	0 on success, -1 on failure
+ */
+long	
+evr_setPrescaler(void* dev, uint8_t select, uint16_t prescaler)
+{
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_SET_PRESCALER);
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][setPrescaler] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+	if (select >= NUMBER_OF_PRESCALERS)
+	{
+		evr_log("[evr][setPrescaler] select must be 0-2\n");
+		release(device);
+		return -1;
+	}
+
+	/*Write new prescalar*/
+	status	=	writecheck(device, REGISTER_PRESCALAR_0+(select*2), prescaler);
+	if (status < 0)
+	{
+		evr_log("[evr][setPrescaler] Couldn't write to register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Reads selected prescalar
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	select		:	Prescalar to be set (0, 1, or 2)
+ * @param	*prescalar	:	Value of prescalar
+ * @return	0 on success, -1 on failure
+ */
+long	
+evr_getPrescaler(void* dev, uint8_t select, uint16_t *prescaler)
+{
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_GET_PRESCALER);
+
+	/*Check selection*/
+	if (!dev)
+	{
+		evr_log("[evr][setPrescaler] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+	if (select >= NUMBER_OF_PRESCALERS)
+	{
+		evr_log("[evr][setPrescaler] select must be 0-2\n");
+		release(device);
+		return -1;
+	}
+
+	/*Read prescaler*/
+	status	=	readreg(device, REGISTER_PRESCALAR_0+(select*2), prescaler);
+	if (status < 0)
+	{
+		evr_log("[evr][setPrescaler] Couldn't read register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1816,25 +2979,25 @@ evr_setTTLSource(void *dev, uint8_t ttl, uint8_t source)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_TTL_SOURCE);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setTTLSource] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setTTLSource] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (ttl >= NUMBER_OF_TTL)
 	{
-		printf("\x1B[31m[evr][setTTLSource] Ttl must be 0-7\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setTTLSource] Ttl must be 0-7\n");
+		release(device);
 		return -1;
 	}
 	if (source >= NUMBER_OF_SOURCES)
 	{
-		printf("\x1B[31m[evr][setTTLSource] Source must be < 64\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setTTLSource] Source must be < 64\n");
+		release(device);
 		return -1;
 	}
 
@@ -1842,15 +3005,13 @@ evr_setTTLSource(void *dev, uint8_t ttl, uint8_t source)
 	status	=	writecheck(device, REGISTER_FP_TTL0 + (ttl*2), source);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setTTLSource] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setTTLSource] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1869,25 +3030,25 @@ evr_getTTLSource(void *dev, uint8_t ttl, uint8_t *source)
 	uint16_t	readback;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_TTL_SOURCE);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getTTLSource] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getTTLSource] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (ttl >= NUMBER_OF_TTL)
 	{
-		printf("\x1B[31m[evr][getTTLSource] Ttl must be 0-7\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getTTLSource] Ttl must be 0-7\n");
+		release(device);
 		return -1;
 	}
 	if (!source)
 	{
-		printf("\x1B[31m[evr][getTTLSource] Null pointer to source\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getTTLSource] Null pointer to source\n");
+		release(device);
 		return -1;
 	}
 
@@ -1895,16 +3056,14 @@ evr_getTTLSource(void *dev, uint8_t ttl, uint8_t *source)
 	status	=	readreg(device, REGISTER_FP_TTL0 + (ttl*2), &readback);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getTTLSource] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getTTLSource] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 	*source	=	readback;
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1922,25 +3081,25 @@ evr_setUNIVSource(void *dev, uint8_t univ, uint8_t source)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_SET_UNIV_SOURCE);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][setUNIVSource] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setUNIVSource] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (univ >= NUMBER_OF_UNIV)
 	{
-		printf("\x1B[31m[evr][setUNIVSource] Univ must be 0-3\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setUNIVSource] Univ must be 0-3\n");
+		release(device);
 		return -1;
 	}
 	if (source >= NUMBER_OF_SOURCES)
 	{
-		printf("\x1B[31m[evr][setUNIVSource] Source must be < 64\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setUNIVSource] Source must be < 64\n");
+		release(device);
 		return -1;
 	}
 
@@ -1948,15 +3107,13 @@ evr_setUNIVSource(void *dev, uint8_t univ, uint8_t source)
 	status	=	writecheck(device, REGISTER_FP_UNIV0 + (univ*2), source);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][setUNIVSource] Couldn't write to register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][setUNIVSource] Couldn't write to register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -1974,25 +3131,25 @@ evr_getUNIVSource(void *dev, uint8_t univ, uint8_t *source)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_UNIV_SOURCE);
 
 	/*Check inputs*/
 	if (!dev)
 	{
-		printf("\x1B[31m[evr][getUNIVSource] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getUNIVSource] Null pointer to device\n");
+		release(device);
 		return -1;
 	}
 	if (univ >= NUMBER_OF_UNIV)
 	{
-		printf("\x1B[31m[evr][getUNIVSource] Univ must be 0-7\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getUNIVSource] Univ must be 0-7\n");
+		release(device);
 		return -1;
 	}
 	if (!source)
 	{
-		printf("\x1B[31m[evr][getUNIVSource] Null pointer to source\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getUNIVSource] Null pointer to source\n");
+		release(device);
 		return -1;
 	}
 
@@ -2000,15 +3157,13 @@ evr_getUNIVSource(void *dev, uint8_t univ, uint8_t *source)
 	status	=	readreg(device, REGISTER_FP_UNIV0 + (univ*2), (uint16_t*)source);
 	if (status < 0)
 	{
-		printf("\x1B[31m[evr][getUNIVSource] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][getUNIVSource] Couldn't read register\n");
+		release(device);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
-
-	return 0;
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
 }
 
 /**
@@ -2024,375 +3179,4035 @@ evr_getFirmwareVersion(void* dev, uint16_t *version)
 	device_t	*device	=	(device_t*)dev;
 
 	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+	acquire(device, API_GET_FIRMWARE_VERSION);
+
+	/*Check inputs*/
+	if (!dev || !version)
+	{
+		evr_log("[evr][getFirmwareVersion] Null pointer.\n");
+		release(device);
+		return -1;
+	}
+
+	status	=	readreg(device, REGISTER_FIRMWARE, version);
+	if (status < 0)
+	{
+		evr_log("[evr][getFirmwareVersion] Couldn't read register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Resets the rx violation flag.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_resetRxViolation(void* dev)
+{
+	uint16_t	data;
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_RESET_RX_VIOLATION);
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][clearRxViolation] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+
+	/*Read control register*/
+	status	=	readreg(device, REGISTER_CONTROL, &data);
+	if (status < 0)
+	{
+		evr_log("[evr][clearRxViolation] Couldn't read register\n");
+		release(device);
+		return -1;
+	}
+
+	status	=	writereg(device, REGISTER_CONTROL, data|CONTROL_RXVIO);
+	if (status < 0)
+	{
+		evr_log("[evr][clearRxVio] Couldn't write to control register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Returns the state of the distributed bus
+ *
+ * Records scanned on I/O Intr are answered from the shadow copy kept by the status poller, see evr_getBitScan.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*data	:	The state of the 8 bus bits, bit 0 is DBUS0
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getDbus(void* dev, uint8_t *data)
+{
+	uint16_t	bus		=	0;
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !data)
+	{
+		evr_log("[evr][getDbus] Null pointers\n");
+		return -1;
+	}
+
+	/*Lock mutex*/
+	acquire(device, API_GET_DBUS);
+
+	status	=	readreg(device, REGISTER_DBUS_DATA, &bus);
+	if (status < 0)
+	{ 
+		evr_log("[evr][getDbus] Couldn't read register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Unlock mutex*/
+	release(device);
+
+	*data	=	bus & 0xff;
+
+	return 0;
+}
+
+/**
+ * @brief	Tests if rx violation flag is set.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @return	0 for false, 1 for true, -1 on failure
+ */
+long
+evr_isRxViolation(void* dev)
+{
+	uint16_t	data	=	0;
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Lock mutex*/
+	acquire(device, API_IS_RX_VIOLATION);
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][isRxViolation] Null pointer to device\n");
+		release(device);
+		return -1;
+	}
+
+	status	=	readreg(device, REGISTER_CONTROL, &data);
+	if (status < 0)
+	{ 
+		evr_log("[evr][isRxViolation] Couldn't read register\n");
+		release(device);
+		return -1;
+	}
+
+	/*Unlock mutex*/
+	release(device);
+
+	return (data&CONTROL_RXVIO);
+}
+
+/**
+ * @brief	Reads a batch of registers
+ *
+ * All reads are pipelined and complete together. The status of every operation is filled in,
+ * so a partial failure identifies exactly which registers could not be read.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*ops	:	Registers to be read, data and status are filled in on return
+ * @param	count	:	Number of operations
+ * @return	0 if all operations succeeded, -1 otherwise
+ */
+long
+evr_readRegs(void* dev, evrop_t *ops, uint32_t count)
+{
+	uint32_t	i;
+	int32_t		status;
+	request_t	*requests;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !ops)
+	{
+		evr_log("[evr][readRegs] Null pointers\n");
+		return -1;
+	}
+	if (!count)
+		return 0;
+
+	requests	=	calloc(count, sizeof(request_t));
+	if (!requests)
+	{
+		evr_log("[evr][readRegs] Unable to allocate requests\n");
+		return -1;
+	}
+
+	/*Prepare requests*/
+	for (i = 0; i < count; i++)
+	{
+		requests[i].access	=	ACCESS_READ;
+		requests[i].reg		=	ops[i].reg;
+	}
+
+	/*Lock mutex*/
+	acquire(device, API_READ_REGS);
+
+	status	=	transfer(device, requests, count);
+
+	/*Unlock mutex*/
+	release(device);
+
+	/*Collect results*/
+	for (i = 0; i < count; i++)
+	{
+		ops[i].data		=	requests[i].data;
+		ops[i].status	=	requests[i].status;
+	}
+	free(requests);
+
+	if (status < 0)
+	{
+		evr_log("[evr][readRegs] Couldn't read registers\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Writes a batch of registers and checks they were written
+ *
+ * Operations are executed in order as a single pipelined batch.
+ * Writes to REGISTER_PULSE_SELECT or REGISTER_MAP_ADDRESS select the pulser or event
+ * that the following operations act upon, exactly as if the registers were written one by one.
+ * Every written register, except the control register, is read back after the writes
+ * that share its selection, and an operation only succeeds if its read-back matches.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*ops	:	Registers and data to be written, status is filled in on return
+ * @param	count	:	Number of operations
+ * @return	0 if all operations succeeded, -1 otherwise
+ */
+long
+evr_writeRegs(void* dev, evrop_t *ops, uint32_t count)
+{
+	uint32_t	i;
+	uint32_t	j;
+	uint32_t	end;
+	uint32_t	total	=	0;
+	int32_t		status;
+	int32_t		*readback;
+	request_t	*requests;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !ops)
+	{
+		evr_log("[evr][writeRegs] Null pointers\n");
+		return -1;
+	}
+	if (!count)
+		return 0;
+
+	requests	=	calloc(2*count, sizeof(request_t));
+	readback	=	calloc(count, sizeof(int32_t));
+	if (!requests || !readback)
+	{
+		evr_log("[evr][writeRegs] Unable to allocate requests\n");
+		free(requests);
+		free(readback);
+		return -1;
+	}
+
+	/*
+	 * Prepare requests: the writes of every selection are followed by the read-backs of those writes,
+	 * so that read-backs of indirect registers happen before the selection changes again
+	 */
+	for (i = 0; i < count; i = end)
+	{
+		/*A selection starts at op i and lasts until the next select register write*/
+		for (end = i + 1; end < count && ops[end].reg != REGISTER_PULSE_SELECT && ops[end].reg != REGISTER_MAP_ADDRESS; end++);
+
+		for (j = i; j < end; j++)
+		{
+			requests[total].access	=	ACCESS_WRITE;
+			requests[total].reg		=	ops[j].reg;
+			requests[total].data	=	ops[j].data;
+			total++;
+		}
+		for (j = i; j < end; j++)
+		{
+			readback[j]	=	-1;
+			if (ops[j].reg == REGISTER_CONTROL)
+				continue;
+			readback[j]				=	total;
+			requests[total].access	=	ACCESS_READ;
+			requests[total].reg		=	ops[j].reg;
+			total++;
+		}
+	}
+
+	/*Lock mutex*/
+	acquire(device, API_WRITE_REGS);
+
+	status	=	transfer(device, requests, total);
+
+	/*Unlock mutex*/
+	release(device);
+
+	/*Collect results*/
+	for (i = 0, j = 0; i < total; i++)
+	{
+		if (requests[i].access != ACCESS_WRITE)
+			continue;
+		ops[j].status	=	requests[i].status;
+		if (readback[j] >= 0 && (requests[readback[j]].status < 0 || requests[readback[j]].data != ops[j].data))
+			ops[j].status	=	-1;
+		if (ops[j].status < 0)
+			status	=	-1;
+		j++;
+	}
+	free(requests);
+	free(readback);
+
+	if (status < 0)
+	{
+		evr_log("[evr][writeRegs] Couldn't write registers\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Forces a refresh of the shadow copy
+ *
+ * Re-reads every register this IOC has a shadow value for, including the pulser registers
+ * and mapping RAM entries that sit behind the select registers.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_refresh(void* dev)
+{
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][refresh] Null pointer to device\n");
+		return -1;
+	}
+
+	/*Lock mutex*/
+	acquire(device, API_REFRESH);
+
+	status	=	reload(device, true);
+	if (status < 0)
+	{
+		evr_log("[evr][refresh] Couldn't read registers\n");
+		release(device);
+		return -1;
+	}
+
+	/*Verify deferred writes and unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Returns the I/O Intr scan list of a status register
+ *
+ * The register is added to the ones read by the status poller, see evrConfigurePoll.
+ * Records on the list are scanned whenever the value of the register changes, and reads
+ * of the register are answered from the shadow copy refreshed by the poller.
+ * Every call adds a user to the register, see evr_releaseIoScan.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of a directly addressed register
+ * @param	*scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getIoScan(void* dev, evrregister_t reg, IOSCANPVT *scan)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !scan)
+	{
+		evr_log("[evr][getIoScan] Null pointers\n");
+		return -1;
+	}
+	if (reg >= REGISTER_SPACE || reg%2 || reg == REGISTER_MAP_DATA || reg == REGISTER_PULSE_PRESCALAR ||
+		(reg >= REGISTER_PULSE_DELAY && reg < REGISTER_PULSE_WIDTH + 4) ||
+		reg == REGISTER_FIFO_EVENT || reg == REGISTER_FIFO_TIME_HI || reg == REGISTER_FIFO_TIME_LO)
+	{
+		evr_log("[evr][getIoScan] Register 0x%02x cannot be polled\n", reg);
+		return -1;
+	}
+
+	/*Lock mutex*/
+	pthread_mutex_lock(&device->mutex);
+
+	if (!device->monitors[reg/2].scan)
+		scanIoInit(&device->monitors[reg/2].scan);
+	*scan	=	device->monitors[reg/2].scan;
+	device->monitors[reg/2].users++;
+
+	/*Unlock mutex*/
+	pthread_mutex_unlock(&device->mutex);
+
+	if (!device->poll)
+		evr_log("[evr][getIoScan] Poller of %s is disabled, I/O Intr records will not be scanned\n", device->name);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the I/O Intr scan list of a bit of a status register
+ *
+ * The register is added to the ones read by the status poller, see evr_getIoScan.
+ * Records on the list are scanned only when the bit changes, not when other bits of the register do.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of a directly addressed register
+ * @param	bit		:	Bit number, 0 is the least significant bit
+ * @param	*scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getBitScan(void* dev, evrregister_t reg, uint8_t bit, IOSCANPVT *scan)
+{
+	IOSCANPVT	watch;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (bit >= REGISTER_BITS)
+	{
+		evr_log("[evr][getBitScan] Bit number must be less than %d\n", REGISTER_BITS);
+		return -1;
+	}
+
+	/*Watch the register*/
+	if (evr_getIoScan(dev, reg, &watch) < 0)
+		return -1;
+
+	/*Lock mutex*/
+	pthread_mutex_lock(&device->mutex);
+
+	if (!device->monitors[reg/2].bits[bit])
+		scanIoInit(&device->monitors[reg/2].bits[bit]);
+	*scan	=	device->monitors[reg/2].bits[bit];
+
+	/*Unlock mutex*/
+	pthread_mutex_unlock(&device->mutex);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the I/O Intr scan list of a status register a record is removed from
+ *
+ * Drops a user added by evr_getIoScan. The status poller stops reading the register
+ * once it has no users left, and the next user starts from a fresh poll.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of a directly addressed register
+ * @param	*scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_releaseIoScan(void* dev, evrregister_t reg, IOSCANPVT *scan)
+{
+	monitor_t	*monitor;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !scan)
+	{
+		evr_log("[evr][releaseIoScan] Null pointers\n");
+		return -1;
+	}
+	if (reg >= REGISTER_SPACE || reg%2)
+	{
+		evr_log("[evr][releaseIoScan] Register 0x%02x is not polled\n", reg);
+		return -1;
+	}
+
+	/*Lock mutex*/
+	pthread_mutex_lock(&device->mutex);
+
+	monitor	=	&device->monitors[reg/2];
+	if (!monitor->users)
+	{
+		pthread_mutex_unlock(&device->mutex);
+		evr_log("[evr][releaseIoScan] Register 0x%02x is not polled\n", reg);
+		return -1;
+	}
+	*scan	=	monitor->scan;
+	monitor->users--;
+	if (!monitor->users)
+		monitor->valid	=	false;
+
+	/*Unlock mutex*/
+	pthread_mutex_unlock(&device->mutex);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the I/O Intr scan list of a bit of a status register a record is removed from
+ *
+ * Drops a user added by evr_getBitScan, see evr_releaseIoScan.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of a directly addressed register
+ * @param	bit		:	Bit number, 0 is the least significant bit
+ * @param	*scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_releaseBitScan(void* dev, evrregister_t reg, uint8_t bit, IOSCANPVT *scan)
+{
+	IOSCANPVT	watch;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (bit >= REGISTER_BITS)
+	{
+		evr_log("[evr][releaseBitScan] Bit number must be less than %d\n", REGISTER_BITS);
+		return -1;
+	}
+
+	/*Stop watching the register*/
+	if (evr_releaseIoScan(dev, reg, &watch) < 0)
+		return -1;
+
+	/*Lock mutex*/
+	pthread_mutex_lock(&device->mutex);
+
+	*scan	=	device->monitors[reg/2].bits[bit];
+
+	/*Unlock mutex*/
+	pthread_mutex_unlock(&device->mutex);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the I/O Intr scan list of an event code
+ *
+ * Records on the list are scanned whenever the event FIFO drain receives the event, see evrConfigureFifo.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	code	:	Event code
+ * @param	*scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getEventScan(void* dev, uint8_t code, IOSCANPVT *scan)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !scan)
+	{
+		evr_log("[evr][getEventScan] Null pointers\n");
+		return -1;
+	}
+
+	/*Lock mutex*/
+	pthread_mutex_lock(&device->mutex);
+
+	if (!device->fifo.scans[code])
+		scanIoInit(&device->fifo.scans[code]);
+	*scan	=	device->fifo.scans[code];
+
+	/*Unlock mutex*/
+	pthread_mutex_unlock(&device->mutex);
+
+	if (!device->fifo.period)
+		evr_log("[evr][getEventScan] Event FIFO drain of %s is disabled, I/O Intr records will not be scanned\n", device->name);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the number of events of a code received through the event FIFO
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	code	:	Event code
+ * @param	*count	:	The number of events, wrapping at 2^32
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getEventCount(void* dev, uint8_t code, uint32_t *count)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !count)
+	{
+		evr_log("[evr][getEventCount] Null pointers\n");
+		return -1;
+	}
+
+	*count	=	__atomic_load_n(&device->fifo.counts[code], __ATOMIC_ACQUIRE);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the timestamp of the last event of a code received through the event FIFO
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	code	:	Event code
+ * @param	*stamp	:	The timestamp counter latched by the device when it received the event
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getEventStamp(void* dev, uint8_t code, uint32_t *stamp)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !stamp)
+	{
+		evr_log("[evr][getEventStamp] Null pointers\n");
+		return -1;
+	}
+
+	*stamp	=	__atomic_load_n(&device->fifo.stamps[code], __ATOMIC_ACQUIRE);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the I/O Intr scan list of the data buffers
+ *
+ * Records on the list are scanned whenever the receiver receives a buffer, see evrConfigureData.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getDataScan(void* dev, IOSCANPVT *scan)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !scan)
+	{
+		evr_log("[evr][getDataScan] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->data.mutex);
+	if (!device->data.scan)
+		scanIoInit(&device->data.scan);
+	*scan	=	device->data.scan;
+	pthread_mutex_unlock(&device->data.mutex);
+
+	if (!device->data.period)
+		evr_log("[evr][getDataScan] Data buffer receiver of %s is disabled, I/O Intr records will not be scanned\n", device->name);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the most recently received data buffer
+ *
+ * The buffer is held until it is given back with evr_releaseData, and is not refilled meanwhile.
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	**buffer	:	The buffer
+ * @return	0 on success, -1 on failure or if no buffer was received yet
+ */
+long
+evr_acquireData(void* dev, evrbuffer_t **buffer)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !buffer)
+	{
+		evr_log("[evr][acquireData] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->data.mutex);
+	*buffer	=	device->data.latest;
+	if (*buffer)
+		(*buffer)->references++;
+	pthread_mutex_unlock(&device->data.mutex);
+
+	return *buffer ? 0 : -1;
+}
+
+/**
+ * @brief	Gives back a data buffer returned by evr_acquireData
+ *
+ * @param	*buffer	:	The buffer
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_releaseData(evrbuffer_t *buffer)
+{
+	device_t	*device;
+
+	/*Check inputs*/
+	if (!buffer || !buffer->device)
+	{
+		evr_log("[evr][releaseData] Null pointers\n");
+		return -1;
+	}
+	device	=	(device_t*)buffer->device;
+
+	pthread_mutex_lock(&device->data.mutex);
+	buffer->references--;
+	pthread_mutex_unlock(&device->data.mutex);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the current time kept by the timestamp counter of the device
+ *
+ * The time is extrapolated from the last sample of the counter, see evrConfigureTime, so the device is not accessed.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*time	:	The current time
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getTime(void* dev, epicsTimeStamp *time)
+{
+	/*Check inputs*/
+	if (!dev || !time)
+	{
+		evr_log("[evr][getTime] Null pointers\n");
+		return -1;
+	}
+
+	return convert((device_t*)dev, true, 0, time);
+}
+
+/**
+ * @brief	Returns the time at which the last event of a code was received through the event FIFO
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	code	:	Event code
+ * @param	*time	:	The time the event was received at
+ * @return	0 on success, -1 on failure or if no event of the code was received yet
+ */
+long
+evr_getEventTime(void* dev, uint8_t code, epicsTimeStamp *time)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !time)
+	{
+		evr_log("[evr][getEventTime] Null pointers\n");
+		return -1;
+	}
+
+	if (!__atomic_load_n(&device->fifo.counts[code], __ATOMIC_ACQUIRE))
+		return -1;
+
+	return convert(device, false, __atomic_load_n(&device->fifo.stamps[code], __ATOMIC_ACQUIRE), time);
+}
+
+/**
+ * @brief	Starts receiving the events of a device
+ *
+ * Each consumer owns its subscriber, and only receives the events pushed after it subscribed.
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	*subscriber	:	The subscriber to initialize
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_subscribe(void* dev, evrsubscriber_t *subscriber)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !subscriber)
+	{
+		evr_log("[evr][subscribe] Null pointers\n");
+		return -1;
+	}
+
+	subscriber->device		=	dev;
+	subscriber->cursor		=	__atomic_load_n(&device->fifo.head, __ATOMIC_ACQUIRE);
+	subscriber->overflows	=	0;
+
+	return 0;
+}
+
+/**
+ * @brief	Receives the events pushed since the last call, without blocking nor locking
+ *
+ * Events overwritten before they are received are skipped and counted in the overflows of the subscriber.
+ *
+ * @param	*subscriber	:	The subscriber, see evr_subscribe
+ * @param	*events		:	Receives the events, oldest first
+ * @param	size		:	Maximum number of events to receive
+ * @param	*count		:	Number of events received
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_receive(evrsubscriber_t *subscriber, evrevent_t *events, uint32_t size, uint32_t *count)
+{
+	uint64_t	head;
+	uint64_t	sequence;
+	evrevent_t	*event;
+	fifo_t		*fifo;
+
+	/*Check inputs*/
+	if (!subscriber || !subscriber->device || !events || !count)
+	{
+		evr_log("[evr][receive] Null pointers\n");
+		return -1;
+	}
+	fifo	=	&((device_t*)subscriber->device)->fifo;
+
+	/*Skip the events that already left the ring*/
+	head	=	__atomic_load_n(&fifo->head, __ATOMIC_ACQUIRE);
+	if (head - subscriber->cursor > FIFO_SIZE)
+	{
+		subscriber->overflows	+=	head - FIFO_SIZE - subscriber->cursor;
+		subscriber->cursor		=	head - FIFO_SIZE;
+	}
+
+	*count	=	0;
+	for (; subscriber->cursor < head && *count < size; subscriber->cursor++)
+	{
+		event		=	&fifo->ring[subscriber->cursor%FIFO_SIZE];
+		sequence	=	__atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+		events[*count].code		=	__atomic_load_n(&event->code, __ATOMIC_RELAXED);
+		events[*count].stamp	=	__atomic_load_n(&event->stamp, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		/*The entry was overwritten before or while it was copied*/
+		if (sequence != subscriber->cursor + 1 || __atomic_load_n(&event->sequence, __ATOMIC_RELAXED) != sequence)
+		{
+			subscriber->overflows++;
+			continue;
+		}
+		events[*count].sequence	=	sequence;
+		(*count)++;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Reads the most recent transactions kept by the flight recorder of the device
+ *
+ * Takes no lock. Transactions overwritten while they are copied are left out, so fewer than
+ * size transactions may be returned even if the recorder holds more.
+ *
+ * @param	*dev			:	A pointer to the device being acted upon
+ * @param	*transactions	:	Where the transactions are stored, oldest first
+ * @param	size			:	Maximum number of transactions to read
+ * @param	*count			:	Number of transactions read
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getTransactions(void* dev, evrtransaction_t *transactions, uint32_t size, uint32_t *count)
+{
+	uint64_t			head;
+	uint64_t			cursor;
+	uint64_t			sequence;
+	evrtransaction_t	*entry;
+	recorder_t			*recorder;
+
+	/*Check inputs*/
+	if (!dev || !transactions || !count)
+	{
+		evr_log("[evr][getTransactions] Null pointers\n");
+		return -1;
+	}
+	recorder	=	&((device_t*)dev)->recorder;
+
+	head	=	__atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
+	if (size > RECORDER_SIZE)
+		size	=	RECORDER_SIZE;
+	cursor	=	(head > size) ? head - size : 0;
+
+	*count	=	0;
+	for (; cursor < head; cursor++)
+	{
+		entry		=	&recorder->ring[cursor%RECORDER_SIZE];
+		sequence	=	__atomic_load_n(&entry->sequence, __ATOMIC_ACQUIRE);
+		transactions[*count].time		=	__atomic_load_n(&entry->time, __ATOMIC_RELAXED);
+		transactions[*count].latency	=	__atomic_load_n(&entry->latency, __ATOMIC_RELAXED);
+		transactions[*count].reg		=	__atomic_load_n(&entry->reg, __ATOMIC_RELAXED);
+		transactions[*count].data		=	__atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+		transactions[*count].access		=	__atomic_load_n(&entry->access, __ATOMIC_RELAXED);
+		transactions[*count].retries	=	__atomic_load_n(&entry->retries, __ATOMIC_RELAXED);
+		transactions[*count].status		=	__atomic_load_n(&entry->status, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		/*The entry was overwritten before or while it was copied*/
+		if (sequence != cursor + 1 || __atomic_load_n(&entry->sequence, __ATOMIC_RELAXED) != sequence)
+			continue;
+		transactions[*count].sequence	=	sequence;
+		memset(transactions[*count].reserved, 0, sizeof(transactions[*count].reserved));
+		(*count)++;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the reason of the last failure of the calling thread, and forgets it
+ *
+ * Meant to be called right after a function failed, to tell link failures from invalid arguments.
+ *
+ * @return	The reason of the failure, EVR_ERROR_NONE if there is no link failure to report
+ */
+evrerror_t
+evr_getError(void)
+{
+	evrerror_t	last	=	reason;
+
+	reason	=	EVR_ERROR_NONE;
+
+	return last;
+}
+
+/**
+ * @brief	Logs an error through errlog, unless its site logged LOG_BURST messages in the current LOG_INTERVAL already
+ *
+ * Suppressed messages are counted, and their number is logged with the next message of the site.
+ * errlog queues messages to its own thread, so failing paths do not wait for the console.
+ *
+ * @param	*limit	:	Rate limit of the logging site
+ * @param	*format	:	printf format of the message, followed by its arguments
+ */
+void
+evr_logLimited(evrlimit_t *limit, const char *format, ...)
+{
+	uint64_t		window;
+	uint64_t		current;
+	uint32_t		suppressed;
+	char			message[256];
+	struct timespec	now;
+	va_list			args;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	window	=	now.tv_sec/LOG_INTERVAL + 1;
+
+	/*The first message of an interval restarts the count*/
+	current	=	__atomic_load_n(&limit->window, __ATOMIC_ACQUIRE);
+	if (current != window && __atomic_compare_exchange_n(&limit->window, &current, window, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		__atomic_store_n(&limit->count, 0, __ATOMIC_RELEASE);
+
+	if (__atomic_add_fetch(&limit->count, 1, __ATOMIC_ACQ_REL) > LOG_BURST)
+	{
+		__atomic_add_fetch(&limit->suppressed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	suppressed	=	__atomic_exchange_n(&limit->suppressed, 0, __ATOMIC_RELAXED);
+	if (suppressed)
+		errlogPrintf("[evr] %u similar messages suppressed\n", suppressed);
+
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	errlogPrintf("%s", message);
+}
+
+/**
+ * @brief	Queues a job for the worker pool of the device
+ *
+ * The job is executed by one of the NUMBER_OF_WORKERS threads of the device, in queueing order.
+ *
+ * @param	*dev		:	A pointer to the device the job acts upon
+ * @param	function	:	Function to be executed
+ * @param	*arg		:	Argument passed to the function
+ * @return	0 on success, -1 if the queue is full
+ */
+long
+evr_submit(void* dev, void (*function)(void*), void *arg)
+{
+	/*Check inputs*/
+	if (!dev || !function)
+	{
+		evr_log("[evr][submit] Null pointers\n");
+		return -1;
+	}
+
+	return enqueue((device_t*)dev, function, arg, EVR_ERROR_NONE);
+}
+
+/**
+ * @brief	Queues a job for the worker pool of a device
+ *
+ * @param	*device		:	A pointer to the device whose workers execute the job
+ * @param	function	:	Function to be executed
+ * @param	*arg		:	Argument passed to the function
+ * @param	error		:	Failure the function finds with evr_getError
+ * @return	0 on success, -1 if the queue is full
+ */
+static long
+enqueue(device_t *device, void (*function)(void*), void *arg, evrerror_t error)
+{
+	job_t		*job;
+
+	pthread_mutex_lock(&device->queue.mutex);
+
+	if (device->queue.depth >= QUEUE_SIZE)
+	{
+		device->queue.rejected++;
+		pthread_mutex_unlock(&device->queue.mutex);
+		return -1;
+	}
+
+	job				=	&device->queue.jobs[(device->queue.head + device->queue.depth)%QUEUE_SIZE];
+	job->function	=	function;
+	job->arg		=	arg;
+	job->error		=	error;
+	clock_gettime(CLOCK_MONOTONIC, &job->queued);
+
+	device->queue.depth++;
+	if (device->queue.depth > device->queue.peak)
+		device->queue.peak	=	device->queue.depth;
+
+	pthread_cond_signal(&device->queue.condition);
+	pthread_mutex_unlock(&device->queue.mutex);
+
+	return 0;
+}
+
+/**
+ * @brief	Has a function executed once the deferred writes of the calling thread are verified
+ *
+ * With a verifier (see evrConfigureVerify), the writes a function makes in deferred mode are read back later,
+ * together with the writes of other calls, and the function returns before they are verified.
+ * A caller that must know the outcome, typically the IO of a record, hands its completion to this function:
+ * the completion is executed by a worker of the device once all writes made by the calling thread since
+ * its previous call to evr_complete are verified, and finds the reason of a failed verification with evr_getError.
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	function	:	Completion to be executed
+ * @param	*arg		:	Argument passed to the completion
+ * @return	1 if the completion was queued, 0 if all writes are verified already and the caller completes at once,
+ * 			-1 if a write was not verified. In the last two cases evr_getError tells the reason, if any
+ */
+long
+evr_complete(void* dev, void (*function)(void*), void *arg)
+{
+	waiter_t	*waiter;
+	evrerror_t	error;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !function)
+	{
+		evr_log("[evr][complete] Null pointers\n");
+		return -1;
+	}
+
+	/*Lock mutex*/
+	pthread_mutex_lock(&device->mutex);
+
+	waiter	=	enlist(device, false);
+	if (!waiter)
+	{
+		pthread_mutex_unlock(&device->mutex);
+		reason	=	EVR_ERROR_NONE;
+		return 0;
+	}
+	if (waiter->checks)
+	{
+		waiter->function	=	function;
+		waiter->arg			=	arg;
+		pthread_mutex_unlock(&device->mutex);
+		return 1;
+	}
+	error			=	waiter->error;
+	waiter->used	=	false;
+
+	/*Unlock mutex*/
+	pthread_mutex_unlock(&device->mutex);
+
+	reason	=	error;
+
+	return (error != EVR_ERROR_NONE) ? -1 : 0;
+}
+
+/**
+ * @brief	Reads back all deferred writes now rather than at the next period of the verifier
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @return	0 if all writes were verified, -1 otherwise
+ */
+long
+evr_verify(void* dev)
+{
+	int32_t		status;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][verify] Null pointer to device\n");
+		return -1;
+	}
+
+	/*Lock mutex*/
+	acquire(device, API_VERIFY);
+
+	status	=	verify(device);
+	if (status < 0)
+	{
+		release(device);
+		return -1;
+	}
+
+	/*Unlock mutex*/
+	return release(device);
+}
+
+/**
+ * @brief	Reads the number of jobs waiting for the worker pool
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*depth	:	The number of queued jobs
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getQueueDepth(void* dev, uint32_t *depth)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !depth)
+	{
+		evr_log("[evr][getQueueDepth] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->queue.mutex);
+	*depth	=	device->queue.depth;
+	pthread_mutex_unlock(&device->queue.mutex);
+
+	return 0;
+}
+
+/**
+ * @brief	Reads the average time from queueing a job to its completion
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	*latency	:	The average latency in milliseconds, 0 if no job completed yet
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getQueueLatency(void* dev, double *latency)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !latency)
+	{
+		evr_log("[evr][getQueueLatency] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->queue.mutex);
+	*latency	=	0;
+	if (device->queue.processed)
+		*latency	=	(device->queue.wait + device->queue.service)/(device->queue.processed*1e6);
+	pthread_mutex_unlock(&device->queue.mutex);
+
+	return 0;
+}
+
+/**
+ * @brief	Reads the smoothed round trip time to the device
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*rtt		:	Smoothed round trip time in milliseconds, 0 until the first measurement
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getRtt(void* dev, double *rtt)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !rtt)
+	{
+		evr_log("[evr][getRtt] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->lock);
+	*rtt	=	device->srtt/1e3;
+	pthread_mutex_unlock(&device->lock);
+
+	return 0;
+}
+
+/**
+ * @brief	Reads the current retransmission timeout of the device
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*timeout	:	Retransmission timeout in milliseconds
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getTimeout(void* dev, double *timeout)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !timeout)
+	{
+		evr_log("[evr][getTimeout] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->lock);
+	*timeout	=	device->rto/1e3;
+	pthread_mutex_unlock(&device->lock);
+
+	return 0;
+}
+
+/**
+ * @brief	Reads the number of retransmissions to the device
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*retransmits	:	Number of retransmissions since initialization
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getRetransmits(void* dev, uint32_t *retransmits)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !retransmits)
+	{
+		evr_log("[evr][getRetransmits] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->lock);
+	*retransmits	=	device->retransmits;
+	pthread_mutex_unlock(&device->lock);
+
+	return 0;
+}
+
+/**
+ * @brief	Reads the number of replies discarded by the device's link
+ *
+ * Replies are discarded if they match no request in flight (late replies to retransmitted requests, duplicates),
+ * or if their size or address do not match the request they claim to answer.
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	*discarded	:	Number of discarded replies since initialization
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getDiscardedReplies(void* dev, uint32_t *discarded)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !discarded)
+	{
+		evr_log("[evr][getDiscardedReplies] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->lock);
+	*discarded	=	device->stale + device->malformed;
+	pthread_mutex_unlock(&device->lock);
+
+	return 0;
+}
+
+/**
+ * @brief	Tells whether the device was brought up
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @return	1 if the device is online, 0 if it is offline or still being brought up, -1 on failure
+ */
+long
+evr_isOnline(void* dev)
+{
+	long		online;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev)
+	{
+		evr_log("[evr][isOnline] Null pointer to device\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->lock);
+	online	=	(device->state == STATE_ONLINE);
+	pthread_mutex_unlock(&device->lock);
+
+	return online;
+}
+
+/**
+ * @brief	Reads the histogram of retransmission timeouts armed for the device
+ *
+ * @param	*dev		:	A pointer to the device being acted upon
+ * @param	*histogram	:	NUMBER_OF_BINS counters, bin n counts transmissions armed with a timeout of 2^n to 2^(n+1) microseconds
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getTimeoutHistogram(void* dev, uint32_t *histogram)
+{
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !histogram)
+	{
+		evr_log("[evr][getTimeoutHistogram] Null pointers\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->lock);
+	memcpy(histogram, device->histogram, sizeof(device->histogram));
+	pthread_mutex_unlock(&device->lock);
+
+	return 0;
+}
+
+/**
+ * @brief	Reads the statistics of the calls to a public function of the device
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	*api	:	Name of the function, with or without its evr_ prefix (e.g. setPulserDelay)
+ * @param	*stats	:	Statistics of the calls since initialization
+ * @return	0 on success, -1 on failure
+ */
+long
+evr_getApiStats(void* dev, const char *api, evrstats_t *stats)
+{
+	uint32_t	i;
+	uint32_t	bin;
+	uint64_t	count;
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !api || !stats)
+	{
+		evr_log("[evr][getApiStats] Null pointers\n");
+		return -1;
+	}
+	if (strncmp(api, "evr_", 4) == 0)
+		api	+=	4;
+	for (i = 0; i < NUMBER_OF_APIS && strcmp(api, apiNames[i]); i++);
+	if (i == NUMBER_OF_APIS)
+	{
+		evr_log("[evr][getApiStats] %s is not a timed function\n", api);
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->lock);
+	*stats	=	device->apis[i];
+	pthread_mutex_unlock(&device->lock);
+
+	/*Find the bin holding the 99th percentile*/
+	stats->tail	=	0;
+	for (bin = 0, count = 0; bin < NUMBER_OF_BINS && stats->calls; bin++)
+	{
+		count	+=	stats->histogram[bin];
+		if (count*100 >= stats->calls*99)
+		{
+			stats->tail	=	(2ULL << bin)*1000;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Writes device's 16-bit register and checks the register was written
+ *
+ * In immediate mode, sends the write and the read-back as one transfer and validates the write.
+ * In deferred mode, sends the write and queues the read-back, see verify().
+ * Must be called with the device mutex held.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of register to be written
+ * @param	data	:	16-bit data to be written to device
+ * @return	0 on success, -1 on failure
+ */
+static long	
+writecheck(void *dev, evrregister_t reg, uint16_t data)
+{
+	int32_t		status;
+	request_t	requests[2];
+	device_t	*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev)
+		return -1;
+
+	/*Defer the read-back, verifying earlier writes first if the selection is about to change or the list is full*/
+	if (device->verify == VERIFY_DEFERRED)
+	{
+		/*With a verifier, failures of earlier writes are reported to their own callers*/
+		if (reg == REGISTER_PULSE_SELECT || reg == REGISTER_MAP_ADDRESS || device->checks >= NUMBER_OF_CHECKS)
+		{
+			status	=	verify(device);
+			if (status < 0 && !device->interval)
+				return -1;
+		}
+
+		status	=	writereg(device, reg, data);
+		if (status < 0)
+			return -1;
+
+		defer(device, reg, data);
+
+		return 0;
+	}
+
+	/*Write data and read it back, always from the device rather than the shadow copy*/
+	requests[0].access	=	ACCESS_WRITE;
+	requests[0].reg		=	reg;
+	requests[0].data	=	data;
+	requests[1].access	=	ACCESS_READ;
+	requests[1].reg		=	reg;
+	requests[1].data	=	0x0000;
+
+	status	=	transfer(device, requests, 2);
+	if (status < 0)
+		return -1;
+
+	/*Check that data was updated*/
+	if (requests[1].data != data)
+	{
+		if (call.device == device)
+			call.failed	=	true;
+		reason	=	EVR_ERROR_MISMATCH;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Reads back all deferred writes as one batch and compares them with the written data
+ *
+ * Without a verifier, the writes read back are the ones of the calling function, which fails if one of them was not verified.
+ * With a verifier, the outcome of every read-back is reported to the waiter of the thread that wrote it, and the waiters
+ * whose read-backs are all done are completed, see evr_complete. Must be called with the device mutex held.
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @return	0 if all writes were verified, -1 otherwise
+ */
+static long
+verify(device_t *device)
+{
+	uint32_t	i;
+	uint32_t	count	=	device->checks;
+	int32_t		status	=	0;
+	evrerror_t	error;
+	evrerror_t	first	=	EVR_ERROR_NONE;
+	evrerror_t	saved	=	reason;
+	request_t	requests[NUMBER_OF_CHECKS];
+	check_t		*check;
+	waiter_t	*waiter;
+
+	if (count)
+	{
+		device->checks	=	0;
+
+		for (i = 0; i < count; i++)
+		{
+			requests[i].access	=	ACCESS_READ;
+			requests[i].reg		=	device->pending[i].reg;
+			requests[i].data	=	0x0000;
+		}
+
+		/*A failed transfer leaves the reason of the failure in reason*/
+		reason	=	EVR_ERROR_NONE;
+		transfer(device, requests, count);
+		error	=	reason;
+
+		for (i = 0; i < count; i++)
+		{
+			check	=	&device->pending[i];
+			waiter	=	check->waiter;
+			if (waiter)
+				waiter->checks--;
+			if (requests[i].status == 0 && requests[i].data == check->data)
+				continue;
+
+			if (first == EVR_ERROR_NONE)
+				first	=	(requests[i].status == 0) ? EVR_ERROR_MISMATCH : error;
+			if (waiter && waiter->error == EVR_ERROR_NONE)
+				waiter->error	=	(requests[i].status == 0) ? EVR_ERROR_MISMATCH : error;
+			evr_log("[evr][verify] Write of 0x%04x to register 0x%02x of %s was not verified\n", check->data, check->reg, device->name);
+			status	=	-1;
+		}
+	}
+
+	/*Complete the waiters whose writes are all verified, those the worker queue has no room for are tried again next time*/
+	for (i = 0; i < NUMBER_OF_CHECKS; i++)
+	{
+		waiter	=	&device->waiters[i];
+		if (!waiter->used || !waiter->function || waiter->checks)
+			continue;
+		if (enqueue(device, waiter->function, waiter->arg, waiter->error) < 0)
+		{
+			evr_log("[evr][verify] Unable to queue the completion of verified writes of %s\n", device->name);
+			continue;
+		}
+		waiter->used	=	false;
+	}
+
+	/*Without a verifier, the writes read back are the caller's own*/
+	reason	=	(status < 0 && !device->interval) ? first : saved;
+
+	return status;
+}
+
+/**
+ * @brief	Queues the read-back of a write, on behalf of the calling thread
+ *
+ * A write to a register whose earlier write is not read back yet supersedes it: the earlier write
+ * can no longer be read back, and is considered verified.
+ * Must be called with the device mutex held, and with room left in the list.
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of the register written
+ * @param	data	:	Data written
+ */
+static void
+defer(device_t *device, evrregister_t reg, uint16_t data)
+{
+	uint32_t	i;
+	check_t		*check;
+
+	for (i = 0; i < device->checks && device->pending[i].reg != reg; i++);
+	check	=	&device->pending[i];
+	if (i < device->checks)
+	{
+		if (check->waiter)
+			check->waiter->checks--;
+	}
+	else
+		device->checks++;
+
+	check->reg		=	reg;
+	check->data		=	data;
+
+	/*Read-backs done when the call completes are reported to the caller by its return value*/
+	check->waiter	=	device->interval ? enlist(device, true) : NULL;
+	if (check->waiter)
+		check->waiter->checks++;
+}
+
+/**
+ * @brief	Returns the waiter of the calling thread, the one that has not asked to be completed yet
+ *
+ * Must be called with the device mutex held.
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @param	create	:	Take a free waiter if the thread has none
+ * @return	The waiter, NULL if the thread has none and none could be taken
+ */
+static waiter_t*
+enlist(device_t *device, bool create)
+{
+	uint32_t	i;
+	waiter_t	*waiter;
+	waiter_t	*free	=	NULL;
+
+	for (i = 0; i < NUMBER_OF_CHECKS; i++)
+	{
+		waiter	=	&device->waiters[i];
+		if (!waiter->used)
+		{
+			if (!free)
+				free	=	waiter;
+			continue;
+		}
+		if (!waiter->function && pthread_equal(waiter->thread, pthread_self()))
+			return waiter;
+	}
+	if (!create || !free)
+		return NULL;
+
+	free->used		=	true;
+	free->thread	=	pthread_self();
+	free->checks	=	0;
+	free->error		=	EVR_ERROR_NONE;
+	free->function	=	NULL;
+	free->arg		=	NULL;
+
+	return free;
+}
+
+/**
+ * @brief	Periodically reads back deferred writes
+ *
+ * Writes are read back together every period configured with evrConfigureVerify, whichever calls made them,
+ * so a burst of record writes costs one batch of read-backs.
+ *
+ * @param	arg	:	Pointer to the device whose writes are read back
+ * @return	NULL
+ */
+static void*
+verifier(void *arg)
+{
+	uint32_t	period;
+	device_t	*device	=	(device_t*)arg;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	while (true)
+	{
+		pthread_mutex_lock(&device->mutex);
+		period	=	device->interval;
+		if (period)
+			verify(device);
+		pthread_mutex_unlock(&device->mutex);
+
+		usleep((period ? period : VERIFY_IDLE)*1000);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Enters the device on behalf of a public function: locks the device mutex and starts timing the call
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @param	api		:	Public function being called
+ */
+static void
+acquire(device_t *device, api_t api)
+{
+	struct timespec	locked;
+
+	clock_gettime(CLOCK_MONOTONIC, &call.start);
+	pthread_mutex_lock(&device->mutex);
+	clock_gettime(CLOCK_MONOTONIC, &locked);
+
+	call.device		=	device;
+	call.api		=	api;
+	call.wait		=	elapsed(&call.start, &locked);
+	call.wire		=	0;
+	call.retries	=	0;
+	call.failed		=	false;
+	reason			=	EVR_ERROR_NONE;
+}
+
+/**
+ * @brief	Leaves the device: verifies deferred writes unless the verifier does, then unlocks the device mutex
+ *
+ * If the thread entered the device through acquire(), the call is accounted to its function before the device is unlocked.
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @return	0 on success, -1 if a deferred write could not be verified
+ */
+static long
+release(device_t *device)
+{
+	int32_t			status;
+	uint32_t		bin;
+	uint64_t		total;
+	struct timespec	now;
+	evrstats_t		*stats;
+
+	/*With a verifier, deferred writes are read back by it*/
+	status	=	device->interval ? 0 : verify(device);
+
+	if (call.device == device)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		total	=	elapsed(&call.start, &now);
+		for (bin = 0; bin < NUMBER_OF_BINS - 1 && ((total/1000) >> (bin + 1)); bin++);
+
+		pthread_mutex_lock(&device->lock);
+		stats			=	&device->apis[call.api];
+		stats->calls++;
+		stats->failures	+=	(call.failed || status < 0);
+		stats->retries	+=	call.retries;
+		stats->wait		+=	call.wait;
+		stats->wire		+=	call.wire;
+		stats->total	+=	total;
+		stats->histogram[bin]++;
+		pthread_mutex_unlock(&device->lock);
+
+		call.device	=	NULL;
+	}
+	pthread_mutex_unlock(&device->mutex);
+
+	return status;
+}
+
+/**
+ * @brief	Reads 16-bit register from device
+ *
+ * Answers from the shadow copy if the cache is enabled or the poller watches the register, and the shadow value is recent enough,
+ * otherwise wraps the read in a single request and hands it to the transfer engine.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of register to be read
+ * @param	*data	:	16-bit data read from register
+ * @return	0 on success, -1 on failure
+ */
+static long
+readreg(void *dev, evrregister_t reg, uint16_t *data)
+{
+	int32_t			status;
+	uint32_t		age;
+	request_t		request;
+	shadow_t		*entry;
+	device_t		*device	=	(device_t*)dev;
+
+	/*Check inputs*/
+	if (!dev || !data)
+		return -1;
+
+	/*Answer from the shadow copy, registers watched by the poller are kept recent by it*/
+	age		=	device->age;
+	if (reg < REGISTER_SPACE && device->monitors[reg/2].users && device->poll*2 > age)
+		age	=	device->poll*2;
+	entry	=	shadow(device, reg);
+	if (fresh(entry, age))
+	{
+		*data	=	entry->data;
+		return 0;
+	}
+
+	/*Prepare request*/
+	request.access	=	ACCESS_READ;
+	request.reg		=	reg;
+	request.data	=	0x0000;
+
+	status	=	transfer(device, &request, 1);
+	if (status < 0)
+		return -1;
+
+	/*Extract data*/
+	*data	=	request.data;
+
+	return 0;
+}
+
+/**
+ * @brief	Writes device's 16-bit register
+ *
+ * Wraps the write in a single request and hands it to the transfer engine.
+ *
+ * @param	*dev	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of register to be read
+ * @param	data	:	16-bit data to be written to device
+ * @return	0 on success, -1 on failure
+ */
+static long
+writereg(void *dev, evrregister_t reg, uint16_t data)
+{
+	request_t	request;
+
+	if (!dev)
+		return -1;
+
+	/*Prepare request*/
+	request.access	=	ACCESS_WRITE;
+	request.reg		=	reg;
+	request.data	=	data;
+
+	return transfer((device_t*)dev, &request, 1);
+}
+
+/**
+ * @brief	Starts gathering a transaction
+ *
+ * A transaction gathers the select write and the data accesses of one logical operation
+ * so that they are handed to the transfer engine as a single batch.
+ * The selection the gathered requests will execute under is tracked as they are added.
+ *
+ * @param	*transaction	:	The transaction
+ * @param	*device			:	A pointer to the device being acted upon
+ */
+static void
+transactionBegin(transaction_t *transaction, device_t *device)
+{
+	memset(transaction, 0, sizeof(*transaction));
+	transaction->device			=	device;
+	transaction->pulseSelect	=	device->pulseSelect;
+	transaction->mapSelect		=	device->mapSelect;
+}
+
+/**
+ * @brief	Appends a request to a transaction
+ *
+ * @return	Index of the request, -1 if the transaction is full
+ */
+static int32_t
+gather(transaction_t *transaction, uint8_t access, evrregister_t reg, uint16_t data)
+{
+	uint32_t	index	=	transaction->count;
+
+	if (index >= TRANSACTION_SIZE)
+	{
+		transaction->overflow	=	true;
+		return -1;
+	}
+
+	transaction->requests[index].access	=	access;
+	transaction->requests[index].reg	=	reg;
+	transaction->requests[index].data	=	data;
+	transaction->results[index]			=	NULL;
+	transaction->checks[index]			=	-1;
+	transaction->count++;
+
+	return index;
+}
+
+/**
+ * @brief	Appends the read-backs of the writes gathered so far
+ */
+static void
+gatherChecks(transaction_t *transaction)
+{
+	uint32_t	i;
+	uint32_t	write;
+
+	for (i = 0; i < transaction->unchecked; i++)
+	{
+		write	=	transaction->writes[i];
+		transaction->checks[write]	=	gather(transaction, ACCESS_READ, transaction->requests[write].reg, 0x0000);
+	}
+	transaction->unchecked	=	0;
+}
+
+/**
+ * @brief	Adds a select register write to a transaction
+ *
+ * Nothing is added if the transaction will already run under the requested selection,
+ * so consecutive operations on the same pulser or event skip the select write altogether.
+ * Writes gathered under the previous selection are read back before the selection changes.
+ *
+ * @param	*transaction	:	The transaction
+ * @param	reg				:	REGISTER_PULSE_SELECT or REGISTER_MAP_ADDRESS
+ * @param	value			:	Value to be selected
+ */
+static void
+transactionSelect(transaction_t *transaction, evrregister_t reg, uint16_t value)
+{
+	int32_t	*selection	=	(reg == REGISTER_PULSE_SELECT) ? &transaction->pulseSelect : &transaction->mapSelect;
+
+	if (*selection == value)
+		return;
+
+	gatherChecks(transaction);
+	transactionWrite(transaction, reg, value, true);
+	*selection				=	value;
+	transaction->selects	=	true;
+}
+
+/**
+ * @brief	Adds a register write to a transaction
+ *
+ * @param	*transaction	:	The transaction
+ * @param	reg				:	Address of register to be written
+ * @param	data			:	16-bit data to be written
+ * @param	check			:	Read the register back and compare, as writecheck() does
+ */
+static void
+transactionWrite(transaction_t *transaction, evrregister_t reg, uint16_t data, bool check)
+{
+	int32_t	index;
+
+	index	=	gather(transaction, ACCESS_WRITE, reg, data);
+	if (index < 0 || !check)
+		return;
+	transaction->writes[transaction->unchecked++]	=	index;
+}
+
+/**
+ * @brief	Adds a register read to a transaction
+ *
+ * The read is answered from the shadow copy right away if the cache allows it,
+ * otherwise data is filled in when the transaction is committed.
+ *
+ * @param	*transaction	:	The transaction
+ * @param	reg				:	Address of register to be read
+ * @param	*data			:	16-bit data read from register
+ */
+static void
+transactionRead(transaction_t *transaction, evrregister_t reg, uint16_t *data)
+{
+	uint32_t	i;
+	int32_t		index;
+	bool		written	=	false;
+	shadow_t	*entry;
+
+	/*Answer from the shadow copy, unless the transaction itself writes the register*/
+	for (i = 0; i < transaction->count; i++)
+		if (transaction->requests[i].access == ACCESS_WRITE && transaction->requests[i].reg == reg)
+			written	=	true;
+	entry	=	lookup(transaction->device, reg, transaction->pulseSelect, transaction->mapSelect);
+	if (!written && fresh(entry, transaction->device->age))
+	{
+		*data	=	entry->data;
+		return;
+	}
+
+	index	=	gather(transaction, ACCESS_READ, reg, 0x0000);
+	if (index < 0)
+		return;
+	transaction->results[index]	=	data;
+}
+
+/**
+ * @brief	Executes a transaction as one batch
+ *
+ * In immediate mode, the read-backs of checked writes are appended to the batch and compared on completion.
+ * In deferred mode, they are handed to verify() like writecheck() does.
+ * Must be called with the device mutex held.
+ *
+ * @param	*transaction	:	The transaction
+ * @return	0 on success, -1 on failure
+ */
+static long
+transactionCommit(transaction_t *transaction)
+{
+	uint32_t	i;
+	int32_t		status;
+	request_t	*requests	=	transaction->requests;
+	device_t	*device		=	transaction->device;
+
+	/*Earlier deferred writes can only be read back under the selection they were written with*/
+	if (device->verify == VERIFY_DEFERRED)
+	{
+		/*With a verifier, their failures are reported to their own callers*/
+		if (transaction->selects || device->checks + transaction->unchecked > NUMBER_OF_CHECKS)
+		{
+			status	=	verify(device);
+			if (status < 0 && !device->interval)
+				return -1;
+		}
+	}
+	else
+		gatherChecks(transaction);
+
+	if (transaction->overflow)
+		return -1;
+	if (!transaction->count)
+		return 0;
+
+	status	=	transfer(device, requests, transaction->count);
+	if (status < 0)
+		return -1;
+
+	for (i = 0; i < transaction->count; i++)
+	{
+		if (transaction->results[i])
+			*transaction->results[i]	=	requests[i].data;
+		if (transaction->checks[i] >= 0 && requests[transaction->checks[i]].data != requests[i].data)
+			status	=	-1;
+	}
+
+	/*Defer the remaining read-backs*/
+	for (i = 0; i < transaction->unchecked; i++)
+		defer(device, requests[transaction->writes[i]].reg, requests[transaction->writes[i]].data);
+
+	return status;
+}
+
+/**
+ * @brief	Tests if a request changes the selection of indirect registers
+ *
+ * Writes to the select registers change the meaning of the pulser and mapping RAM data registers,
+ * and reads of the event FIFO pop it and latch the timestamp registers of the popped event,
+ * so they act as barriers: they are only sent once everything before them has completed,
+ * and nothing after them is sent until they complete.
+ *
+ * @param	*request	:	The request being tested
+ * @return	true if the request is a barrier, false otherwise
+ */
+static bool
+isBarrier(request_t *request)
+{
+	if (request->access == ACCESS_READ)
+		return (request->reg == REGISTER_FIFO_EVENT);
+	return (request->reg == REGISTER_PULSE_SELECT || request->reg == REGISTER_MAP_ADDRESS);
+}
+
+/**
+ * @brief	Returns the number of milliseconds, rounded up, from now until the given time, or 0 if it has passed
+ */
+static int32_t
+remaining(struct timespec *deadline)
+{
+	int64_t			nanoseconds;
+	struct timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	nanoseconds	=	(deadline->tv_sec - now.tv_sec)*1000000000LL + (deadline->tv_nsec - now.tv_nsec);
+
+	return (nanoseconds > 0) ? (nanoseconds + 999999)/1000000 : 0;
+}
+
+/**
+ * @brief	Sends (or resends) the message held by a slot and arms its retransmission deadline
+ */
+static void
+transmit(device_t *device, slot_t *slot)
+{
+	uint32_t	bin;
+
+	clock_gettime(CLOCK_MONOTONIC, &slot->sent);
+	if (!slot->retries)
+		slot->first	=	slot->sent;
+
+	slot->deadline			=	slot->sent;
+	slot->deadline.tv_sec	+=	slot->timeout/1000000;
+	slot->deadline.tv_nsec	+=	(slot->timeout%1000000)*1000;
+	if (slot->deadline.tv_nsec >= 1000000000)
+	{
+		slot->deadline.tv_sec++;
+		slot->deadline.tv_nsec	-=	1000000000;
+	}
+
+	for (bin = 0; bin < NUMBER_OF_BINS - 1 && (slot->timeout >> (bin + 1)); bin++);
+	device->histogram[bin]++;
+
+	/*A failed send is handled like a lost datagram: the request times out and is retransmitted*/
+	send(device->socket, &slot->message, sizeof(slot->message), 0);
+}
+
+/**
+ * @brief	Completion callback of the requests issued by transfer(): wakes the waiting caller up
+ *
+ * Called by the reactor with the slot lock of the device held.
+ */
+static void
+finished(void *dev, slot_t *slot)
+{
+	trace((device_t*)dev, slot);
+	pthread_cond_broadcast(&((device_t*)dev)->completion);
+}
+
+/**
+ * @brief	Records a completed request in the flight recorder of the device
+ *
+ * Called by the reactor with the slot lock of the device held.
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @param	*slot	:	Slot of the completed request
+ */
+static void
+trace(device_t *device, slot_t *slot)
+{
+	struct timespec		now;
+	struct timespec		stamp;
+	recorder_t			*recorder	=	&device->recorder;
+	evrtransaction_t	*entry		=	&recorder->ring[recorder->head%RECORDER_SIZE];
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	clock_gettime(CLOCK_REALTIME, &stamp);
+
+	/*Invalidate the entry while it is rewritten, readers check the sequence number before and after copying it*/
+	__atomic_store_n(&entry->sequence, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&entry->time, stamp.tv_sec*1000000000LL + stamp.tv_nsec, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->latency, elapsed(&slot->first, &now)/1000, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->reg, slot->request->reg, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->data, slot->request->data, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->access, slot->request->access, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->retries, (slot->retries < UINT8_MAX) ? slot->retries : UINT8_MAX, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->status, slot->request->status, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->sequence, recorder->head + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&recorder->head, recorder->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief	Executes a batch of register accesses on the device
+ *
+ * Keeps up to NUMBER_OF_SLOTS requests in flight at once. Every request is stamped with the next
+ * sequence number of the device as reference, which the device echoes back, and replies are matched to their requests by that reference,
+ * so a batch costs roughly one round trip per window rather than one round trip per register.
+ * Replies and retransmissions are handled by the reactor, the caller only sleeps until requests complete.
+ * Two requests to the same register are never in flight together, so accesses to a register
+ * always execute in the order given. Writes to the select registers are barriers, see isBarrier().
+ * If a barrier fails, the remaining requests of the batch are failed without being sent.
+ * The shadow copy is updated as requests complete.
+ *
+ * @param	*device		:	A pointer to the device being acted upon
+ * @param	*requests	:	Requests to be executed, in order. Status and read data are filled in on return
+ * @param	count		:	Number of requests
+ * @return	0 if all requests succeeded, -1 otherwise
+ */
+static long
+transfer(device_t *device, request_t *requests, uint32_t count)
+{
+	uint32_t		i;
+	uint32_t		next		=	0;
+	uint32_t		completed	=	0;
+	uint32_t		outstanding	=	0;
+	uint64_t		one			=	1;
+	bool			barrier		=	false;
+	bool			failed		=	false;
+	bool			lost;
+	bool			busy;
+	bool			sent;
+	uint64_t		retries		=	0;
+	struct timespec	start;
+	struct timespec	end;
+	slot_t			*slots;
+	slot_t			*slot;
+
+	if (!device || !requests)
+		return -1;
+
+	slots	=	device->slots;
+	for (i = 0; i < count; i++)
+		requests[i].status	=	-1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_lock(&device->lock);
+
+	/*Requests to an offline or starting device fail without waiting for timeouts, except the ones bringing it up*/
+	if (device->state == STATE_OFFLINE || (device->state == STATE_STARTING && !starting))
+	{
+		pthread_mutex_unlock(&device->lock);
+		if (call.device == device)
+			call.failed	=	true;
+		reason	=	EVR_ERROR_OFFLINE;
+		return -1;
+	}
+	while (completed < count)
+	{
+		/*Fill the window*/
+		sent	=	false;
+		while (next < count && outstanding < NUMBER_OF_SLOTS && !barrier)
+		{
+			/*Barriers wait for the window to drain*/
+			if (isBarrier(&requests[next]) && outstanding > 0)
+				break;
+
+			/*Keep accesses to the same register in order*/
+			busy	=	false;
+			for (i = 0; i < NUMBER_OF_SLOTS; i++)
+				if (slots[i].request && slots[i].request->reg == requests[next].reg)
+					busy	=	true;
+			if (busy)
+				break;
+
+			for (slot = slots; slot->request; slot++);
+			slot->request			=	&requests[next];
+			slot->retries			=	0;
+			slot->timeout			=	device->rto;
+			slot->done				=	false;
+			slot->complete			=	finished;
+			slot->message.access	=	requests[next].access;
+			slot->message.status	=	0;
+			slot->message.data		=	(requests[next].access == ACCESS_WRITE) ? htons(requests[next].data) : 0x0000;
+			slot->message.address	=	htonl(REGISTER_BASE_ADDRESS + requests[next].reg);
+			slot->message.reference	=	htonl(device->reference++);
+			transmit(device, slot);
+
+			barrier	=	isBarrier(&requests[next]);
+			sent	=	true;
+			outstanding++;
+			next++;
+		}
+
+		/*Have the reactor take the new deadlines into account*/
+		if (sent && write(wakeup, &one, sizeof(one)) != sizeof(one))
+			evr_log("[evr][transfer] Unable to wake the reactor up\n");
+
+		/*Sleep until the reactor completes a request*/
+		for (;;)
+		{
+			for (i = 0; i < NUMBER_OF_SLOTS && !(slots[i].request && slots[i].done); i++);
+			if (i < NUMBER_OF_SLOTS)
+				break;
+			pthread_cond_wait(&device->completion, &device->lock);
+		}
+
+		/*Collect completed requests*/
+		for (i = 0; i < NUMBER_OF_SLOTS; i++)
+		{
+			slot	=	&slots[i];
+			if (!slot->request || !slot->done)
+				continue;
+			remember(device, slot->request);
+			if (isBarrier(slot->request))
+			{
+				barrier	=	false;
+				if (slot->request->status < 0)
+				{
+					/*The selection is unknown, so nothing after the barrier can be trusted*/
+					completed	+=	count - next;
+					next		=	count;
+				}
+			}
+			if (slot->request->status < 0)
+				failed	=	true;
+			retries			+=	slot->retries;
+			slot->request	=	NULL;
+			outstanding--;
+			completed++;
+		}
+	}
+
+	/*An online device that keeps failing transfers is taken offline and handed back to its starter*/
+	device->timeouts	=	failed ? device->timeouts + 1 : 0;
+	lost				=	(device->state == STATE_ONLINE && device->timeouts >= OFFLINE_FAILURES);
+	if (lost)
+	{
+		device->state	=	STATE_OFFLINE;
+		forget(device);
+		pthread_cond_broadcast(&device->lost);
+	}
+	pthread_mutex_unlock(&device->lock);
+	if (lost)
+		evr_log("[evr][transfer] %s stopped answering, it is offline\n", device->name);
+
+	/*Account the transfer to the call being timed, if any*/
+	if (call.device == device)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		call.wire		+=	elapsed(&start, &end);
+		call.retries	+=	retries;
+		call.failed		|=	failed;
+	}
+	if (failed)
+		reason	=	EVR_ERROR_TIMEOUT;
+
+	return failed ? -1 : 0;
+}
+
+/**
+ * @brief	Updates the retransmission timeout of a device with a round trip time measurement
+ *
+ * Keeps a smoothed round trip time and its variation as in RFC 6298 (Jacobson/Karels),
+ * and sets the retransmission timeout to srtt + 4*rttvar, within MINIMUM_TIMEOUT and TIMEOUT.
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @param	rtt		:	Round trip time in us
+ */
+static void
+estimate(device_t *device, int64_t rtt)
+{
+	int64_t	delta;
+	int64_t	rto;
+
+	if (!device->samples)
+	{
+		device->srtt	=	rtt;
+		device->rttvar	=	rtt/2;
+	}
+	else
+	{
+		delta			=	rtt - device->srtt;
+		device->rttvar	+=	((delta < 0 ? -delta : delta) - device->rttvar)/4;
+		device->srtt	+=	delta/8;
+	}
+	device->samples++;
+
+	rto	=	device->srtt + 4*device->rttvar;
+	if (rto < MINIMUM_TIMEOUT*1000)
+		rto	=	MINIMUM_TIMEOUT*1000;
+	if (rto > TIMEOUT*1000)
+		rto	=	TIMEOUT*1000;
+	device->rto	=	rto;
+}
+
+/**
+ * @brief	Receives the replies and retransmits the requests of all devices
+ *
+ * A single thread multiplexes the sockets of all configured devices, matches replies to the
+ * requests in flight by their reference and completes them through their callback.
+ * All queued replies are drained on every wakeup. A reply is only accepted if its address also
+ * matches the request, late replies to requests that already completed and duplicates are discarded and counted.
+ * Replies to requests sent only once update the round trip time estimate, see estimate().
+ * Requests that are not answered in time are retransmitted with an exponentially growing timeout,
+ * the timeout of the device is backed off once per sweep however many of its requests expired in it,
+ * and fail once they were sent NUMBER_OF_RETRIES times and TIMEOUT ms passed since the first transmission,
+ * so a slow or dead device only delays the callers of that device.
+ *
+ * @param	*arg	:	Unused
+ */
+static void*
+reactor(void *arg)
+{
+	int32_t				status;
+	int32_t				timeout;
+	int32_t				count;
+	uint32_t			i;
+	uint32_t			j;
+	uint64_t			value;
+	bool				backed;
+	message_t			reply;
+	slot_t				*slot;
+	device_t			*device;
+	struct timespec		now;
+	struct epoll_event	ready[NUMBER_OF_READY];
+
+	for (;;)
+	{
+		/*Sleep until a reply arrives, requests are sent, or the earliest retransmission deadline passes*/
+		timeout	=	-1;
+		for (i = 0; i < deviceCount; i++)
+		{
+			device	=	devices[i];
+			pthread_mutex_lock(&device->lock);
+			for (j = 0; j < NUMBER_OF_SLOTS; j++)
+			{
+				slot	=	&device->slots[j];
+				if (slot->request && !slot->done && (timeout < 0 || remaining(&slot->deadline) < timeout))
+					timeout	=	remaining(&slot->deadline);
+			}
+			pthread_mutex_unlock(&device->lock);
+		}
+		count	=	epoll_wait(events, ready, NUMBER_OF_READY, timeout);
+
+		/*Match all pending replies to their requests, drop the ones that match nothing*/
+		for (i = 0; i < (uint32_t)(count > 0 ? count : 0); i++)
+		{
+			device	=	(device_t*)ready[i].data.ptr;
+			if (!device)
+			{
+				while (read(wakeup, &value, sizeof(value)) > 0);
+				continue;
+			}
+
+			pthread_mutex_lock(&device->lock);
+			while ((status = recv(device->socket, &reply, sizeof(reply), MSG_DONTWAIT)) >= 0)
+			{
+				if (status != sizeof(reply))
+				{
+					device->malformed++;
+					continue;
+				}
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				for (j = 0; j < NUMBER_OF_SLOTS; j++)
+				{
+					slot	=	&device->slots[j];
+					if (!slot->request || slot->done || slot->message.reference != reply.reference)
+						continue;
+					if (slot->message.address != reply.address)
+					{
+						device->malformed++;
+						break;
+					}
+
+					/*Karn's rule: the reply to a retransmitted request cannot be attributed to one transmission*/
+					if (!slot->retries)
+						estimate(device, elapsed(&slot->sent, &now)/1000);
+					if (slot->request->access == ACCESS_READ)
+						slot->request->data	=	ntohs(reply.data);
+					slot->request->status	=	0;
+					slot->done				=	true;
+					slot->complete(device, slot);
+					break;
+				}
+				if (j == NUMBER_OF_SLOTS)
+					device->stale++;
+			}
+			pthread_mutex_unlock(&device->lock);
+		}
+
+		/*Retransmit or fail expired requests*/
+		for (i = 0; i < deviceCount; i++)
+		{
+			device	=	devices[i];
+			backed	=	false;
+			pthread_mutex_lock(&device->lock);
+			for (j = 0; j < NUMBER_OF_SLOTS; j++)
+			{
+				slot	=	&device->slots[j];
+				if (!slot->request || slot->done || remaining(&slot->deadline) > 0)
+					continue;
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				if (slot->retries + 1 < NUMBER_OF_RETRIES || elapsed(&slot->first, &now) < TIMEOUT*1000000LL)
+				{
+					/*Back off, for this request and, once per timeout event, for the ones to come until a new measurement*/
+					slot->timeout	=	(slot->timeout < TIMEOUT*500) ? slot->timeout*2 : TIMEOUT*1000;
+					if (!backed)
+						device->rto	=	(device->rto < TIMEOUT*500) ? device->rto*2 : TIMEOUT*1000;
+					backed			=	true;
+					device->retransmits++;
+					slot->retries++;
+					transmit(device, slot);
+					continue;
+				}
+				device->failures++;
+				slot->done	=	true;
+				slot->complete(device, slot);
+			}
+			pthread_mutex_unlock(&device->lock);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Returns the shadow entry of a register under the current selection
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @param	reg		:	Address of the register
+ * @return	Pointer to the shadow entry, NULL if the register is not shadowed or the selection is unknown
+ */
+static shadow_t*
+shadow(device_t *device, evrregister_t reg)
+{
+	return lookup(device, reg, device->pulseSelect, device->mapSelect);
+}
+
+/**
+ * @brief	Returns the shadow entry of a register under the given selection
+ *
+ * Pulser registers and the mapping RAM data register are resolved through the
+ * value of their select register.
+ *
+ * @param	*device			:	A pointer to the device being acted upon
+ * @param	reg				:	Address of the register
+ * @param	pulseSelect		:	Value of REGISTER_PULSE_SELECT, -1 if unknown
+ * @param	mapSelect		:	Value of REGISTER_MAP_ADDRESS, -1 if unknown
+ * @return	Pointer to the shadow entry, NULL if the register is not shadowed or the selection is unknown
+ */
+static shadow_t*
+lookup(device_t *device, evrregister_t reg, int32_t pulseSelect, int32_t mapSelect)
+{
+	int32_t	index;
+
+	switch ((uint32_t)reg)
+	{
+		case REGISTER_PULSE_PRESCALAR:	index	=	0;	break;
+		case REGISTER_PULSE_DELAY:		index	=	1;	break;
+		case REGISTER_PULSE_DELAY+2:	index	=	2;	break;
+		case REGISTER_PULSE_WIDTH:		index	=	3;	break;
+		case REGISTER_PULSE_WIDTH+2:	index	=	4;	break;
+		case REGISTER_MAP_DATA:
+			if (mapSelect < 0)
+				return NULL;
+			return &device->map[mapSelect];
+		/*Reading the event FIFO pops it, so its registers are never shadowed nor read again by a refresh*/
+		case REGISTER_FIFO_EVENT:
+		case REGISTER_FIFO_TIME_HI:
+		case REGISTER_FIFO_TIME_LO:
+			return NULL;
+		default:
+			if (reg >= REGISTER_SPACE || reg%2)
+				return NULL;
+			return &device->registers[reg/2];
+	}
+
+	if (pulseSelect < 0)
+		return NULL;
+	return &device->pulsers[pulseSelect][index];
+}
+
+/**
+ * @brief	Tests if a shadow entry is recent enough to answer a read from cache
+ *
+ * @param	*entry	:	The shadow entry, may be NULL
+ * @param	age		:	Maximum age in ms, 0 never answers from cache
+ * @return	true if the entry is valid and recent enough, false otherwise
+ */
+static bool
+fresh(shadow_t *entry, uint32_t age)
+{
+	struct timespec	now;
+
+	if (!age || !entry || !entry->valid)
+		return false;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((now.tv_sec - entry->stamp.tv_sec)*1000 + (now.tv_nsec - entry->stamp.tv_nsec)/1000000 <= age);
+}
+
+/**
+ * @brief	Updates the shadow copy with the outcome of a request
+ *
+ * Successful reads and writes record the register value.
+ * Failed writes leave the register in an unknown state and invalidate the entry.
+ * Writes to the control register are not recorded since some of its bits are self-clearing,
+ * but a flush is known to clear the whole mapping RAM.
+ *
+ * @param	*device		:	A pointer to the device being acted upon
+ * @param	*request	:	The completed request
+ */
+static void
+remember(device_t *device, request_t *request)
+{
+	uint32_t		i;
+	shadow_t		*entry;
+	struct timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	/*Track selections*/
+	if (request->access == ACCESS_WRITE || request->status == 0)
+	{
+		if (request->reg == REGISTER_PULSE_SELECT)
+			device->pulseSelect	=	(request->status < 0 || request->data >= NUMBER_OF_SELECTS) ? -1 : request->data;
+		if (request->reg == REGISTER_MAP_ADDRESS)
+			device->mapSelect	=	(request->status < 0 || request->data >= NUMBER_OF_EVENTS) ? -1 : request->data;
+	}
+
+	entry	=	shadow(device, request->reg);
+	if (!entry)
+		return;
+
+	if (request->status < 0)
+	{
+		if (request->access == ACCESS_WRITE)
+			entry->valid	=	false;
+		return;
+	}
+	if (request->access == ACCESS_WRITE && request->reg == REGISTER_CONTROL)
+	{
+		entry->valid	=	false;
+		if (request->data & CONTROL_FLUSH)
+		{
+			for (i = 0; i < NUMBER_OF_EVENTS; i++)
+			{
+				device->map[i].data		=	0;
+				device->map[i].valid	=	true;
+				device->map[i].stamp	=	now;
+			}
+		}
+		return;
+	}
+
+	entry->data		=	request->data;
+	entry->valid	=	true;
+	entry->stamp	=	now;
+}
+
+/**
+ * @brief	Forgets the shadow copy and the selections of a device that stopped answering
+ *
+ * The device may have been reset while it was not answering, so nothing known about it can be trusted.
+ * Must be called with the lock of the device held.
+ *
+ * @param	*device		:	A pointer to the device being acted upon
+ */
+static void
+forget(device_t *device)
+{
+	uint32_t	i;
+	uint32_t	j;
+
+	for (i = 0; i < REGISTER_SPACE/2; i++)
+		device->registers[i].valid	=	false;
+	for (i = 0; i < NUMBER_OF_SELECTS; i++)
+		for (j = 0; j < PULSE_REGISTERS; j++)
+			device->pulsers[i][j].valid	=	false;
+	for (i = 0; i < NUMBER_OF_EVENTS; i++)
+		device->map[i].valid	=	false;
+
+	device->pulseSelect	=	-1;
+	device->mapSelect	=	-1;
+}
+
+/**
+ * @brief	Re-reads shadowed registers from the device as one batch
+ *
+ * @param	*device		:	A pointer to the device being acted upon
+ * @param	indirect	:	Also re-read the valid entries behind the select registers
+ * @return	0 on success, -1 on failure
+ */
+static long
+reload(device_t *device, bool indirect)
+{
+	uint32_t	i;
+	uint32_t	j;
+	uint32_t	count	=	0;
+	int32_t		status;
+	request_t	*requests;
+	evrregister_t	pulse[PULSE_REGISTERS]	=	{REGISTER_PULSE_PRESCALAR, REGISTER_PULSE_DELAY, REGISTER_PULSE_DELAY+2, REGISTER_PULSE_WIDTH, REGISTER_PULSE_WIDTH+2};
+
+	requests	=	calloc(REGISTER_SPACE/2 + NUMBER_OF_SELECTS*(PULSE_REGISTERS + 1) + NUMBER_OF_EVENTS*2, sizeof(request_t));
+	if (!requests)
+		return -1;
+
+	/*Directly addressed registers*/
+	for (i = 0; i < REGISTER_SPACE/2; i++)
+	{
+		if (!device->registers[i].valid || shadow(device, i*2) != &device->registers[i])
+			continue;
+		requests[count].access	=	ACCESS_READ;
+		requests[count].reg		=	i*2;
+		count++;
+	}
+
+	/*Registers behind the select registers*/
+	for (i = 0; indirect && i < NUMBER_OF_SELECTS; i++)
+	{
+		for (j = 0; j < PULSE_REGISTERS && !device->pulsers[i][j].valid; j++);
+		if (j == PULSE_REGISTERS)
+			continue;
+		requests[count].access	=	ACCESS_WRITE;
+		requests[count].reg		=	REGISTER_PULSE_SELECT;
+		requests[count].data	=	i;
+		count++;
+		for (j = 0; j < PULSE_REGISTERS; j++)
+		{
+			if (!device->pulsers[i][j].valid)
+				continue;
+			requests[count].access	=	ACCESS_READ;
+			requests[count].reg		=	pulse[j];
+			count++;
+		}
+	}
+	for (i = 0; indirect && i < NUMBER_OF_EVENTS; i++)
+	{
+		if (!device->map[i].valid)
+			continue;
+		requests[count].access	=	ACCESS_WRITE;
+		requests[count].reg		=	REGISTER_MAP_ADDRESS;
+		requests[count].data	=	i;
+		count++;
+		requests[count].access	=	ACCESS_READ;
+		requests[count].reg		=	REGISTER_MAP_DATA;
+		count++;
+	}
+
+	status	=	transfer(device, requests, count);
+	free(requests);
+
+	return status;
+}
+
+/**
+ * @brief	Periodically re-reads the directly addressed registers held in the shadow copy
+ *
+ * Nothing is read while the device is not online.
+ *
+ * @param	arg	:	Pointer to the device being refreshed
+ * @return	NULL
+ */
+static void*
+refresher(void *arg)
+{
+	device_t	*device	=	(device_t*)arg;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	while (true)
+	{
+		usleep(device->refresh*1000);
+
+		/*An offline device is brought up again by the starter, which reloads it*/
+		if (evr_isOnline(device) != 1)
+			continue;
+
+		pthread_mutex_lock(&device->mutex);
+		if (reload(device, false) < 0)
+			evr_log("[evr][refresher] Unable to refresh %s\n", device->name);
+		pthread_mutex_unlock(&device->mutex);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Periodically reads the watched registers as one batch and scans the records of those that changed
+ *
+ * Records of a bit of a register are scanned only when that bit changes.
+ * Nothing is read while the device is not online, the values are forgotten so that the first poll once it is back scans the records.
+ *
+ * @param	arg	:	Pointer to the device being polled
+ * @return	NULL
+ */
+static void*
+poller(void *arg)
+{
+	uint32_t	i;
+	uint32_t	j;
+	uint32_t	count;
+	uint32_t	changes;
+	uint16_t	flips;
+	monitor_t	*monitor;
+	request_t	requests[REGISTER_SPACE/2];
+	IOSCANPVT	scans[REGISTER_SPACE/2*(REGISTER_BITS + 1)];
+	device_t	*device	=	(device_t*)arg;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	while (true)
+	{
+		usleep(device->poll*1000);
+
+		pthread_mutex_lock(&device->mutex);
+
+		if (evr_isOnline(device) != 1)
+		{
+			for (i = 0; i < REGISTER_SPACE/2; i++)
+				device->monitors[i].valid	=	false;
+			pthread_mutex_unlock(&device->mutex);
+			continue;
+		}
+
+		count	=	0;
+		for (i = 0; i < REGISTER_SPACE/2; i++)
+		{
+			if (!device->monitors[i].users)
+				continue;
+			requests[count].access	=	ACCESS_READ;
+			requests[count].reg		=	i*2;
+			count++;
+		}
+		if (count && transfer(device, requests, count) < 0)
+			evr_log("[evr][poller] Unable to poll %s\n", device->name);
+
+		/*A failed read forgets the value, so that the next successful one scans the records*/
+		changes	=	0;
+		for (i = 0; i < count; i++)
+		{
+			monitor	=	&device->monitors[requests[i].reg/2];
+			if (requests[i].status < 0)
+			{
+				monitor->valid	=	false;
+				continue;
+			}
+			flips	=	monitor->valid ? (monitor->data ^ requests[i].data) : 0xffff;
+			if (flips)
+				scans[changes++]	=	monitor->scan;
+			for (j = 0; j < REGISTER_BITS; j++)
+			{
+				if ((flips & (1 << j)) && monitor->bits[j])
+					scans[changes++]	=	monitor->bits[j];
+			}
+			monitor->data	=	requests[i].data;
+			monitor->valid	=	true;
+		}
+
+		pthread_mutex_unlock(&device->mutex);
+
+		/*Scan outside the device lock since processing the records locks the device*/
+		for (i = 0; i < changes; i++)
+			scanIoRequest(scans[i]);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Drains the event FIFO into the event ring
+ *
+ * Each pop reads the event code alone, and the timestamp it latched only if there was an event.
+ * Event code 0 is never stored by the device, so it marks an empty FIFO and ends the burst: an idle FIFO costs one read per period.
+ * The device mutex is taken for one pop at a time, so public functions and record IO interleave with a long drain.
+ * Pops follow each other while the FIFO holds events, pausing after FIFO_BURST of them, and the FIFO is polled every period once it is empty.
+ * Events are pushed to the event ring, and records of the received event codes are scanned.
+ * A pop whose reply is lost and retransmitted pops the FIFO twice, the first event is then lost.
+ * The FIFO is not read while the device is not online.
+ *
+ * @param	arg	:	Pointer to the device being drained
+ * @return	NULL
+ */
+static void*
+drainer(void *arg)
+{
+	int32_t		status;
+	uint32_t	pops;
+	bool		empty;
+	uint8_t		code;
+	uint32_t	stamp;
+	evrevent_t	*event;
+	request_t	pop;
+	request_t	requests[2];
+	IOSCANPVT	scan;
+	device_t	*device	=	(device_t*)arg;
+	fifo_t		*fifo	=	&device->fifo;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	pop.access			=	ACCESS_READ;
+	pop.reg				=	REGISTER_FIFO_EVENT;
+	requests[0].access	=	ACCESS_READ;
+	requests[0].reg		=	REGISTER_FIFO_TIME_HI;
+	requests[1].access	=	ACCESS_READ;
+	requests[1].reg		=	REGISTER_FIFO_TIME_LO;
+
+	while (true)
+	{
+		if (evr_isOnline(device) != 1)
+		{
+			usleep(fifo->period*1000);
+			continue;
+		}
+
+		empty	=	false;
+		for (pops = 0; pops < FIFO_BURST && !empty; pops++)
+		{
+			pthread_mutex_lock(&device->mutex);
+
+			status	=	transfer(device, &pop, 1);
+			fifo->reads++;
+			code	=	pop.data & 0xff;
+			if (status < 0 || !code)
+			{
+				if (status < 0)
+					fifo->errors++;
+				pthread_mutex_unlock(&device->mutex);
+				empty	=	true;
+				continue;
+			}
+
+			status	=	transfer(device, requests, 2);
+			stamp	=	(status < 0) ? 0 : ((uint32_t)requests[0].data << 16 | requests[1].data);
+
+			/*
+			 * Publish the event, consumers never take the device mutex.
+			 * The sequence number is cleared while the entry is rewritten, so that a consumer
+			 * copying it meanwhile sees the change and drops the copy.
+			 */
+			event	=	&fifo->ring[fifo->head%FIFO_SIZE];
+			__atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_RELEASE);
+			__atomic_store_n(&event->code, code, __ATOMIC_RELAXED);
+			__atomic_store_n(&event->stamp, stamp, __ATOMIC_RELAXED);
+			__atomic_store_n(&event->sequence, fifo->head + 1, __ATOMIC_RELEASE);
+			__atomic_store_n(&fifo->head, fifo->head + 1, __ATOMIC_RELEASE);
+
+			__atomic_store_n(&fifo->stamps[code], stamp, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&fifo->counts[code], 1, __ATOMIC_RELEASE);
+			scan	=	fifo->scans[code];
+
+			pthread_mutex_unlock(&device->mutex);
+
+			/*Scan outside the device lock since processing the records locks the device*/
+			if (scan)
+				scanIoRequest(scan);
+
+			/*Let threads waiting for the device take it before the next pop*/
+			sched_yield();
+		}
+
+		/*Pause between back to back bursts, otherwise record IO waiting for the device mutex could starve*/
+		usleep(empty ? fifo->period*1000 : FIFO_PAUSE);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Writes the events of a device to a file, one "sequence code timestamp" line per event
+ *
+ * Lost events are written as a comment line giving their number.
+ *
+ * @param	arg	:	Pointer to the log
+ * @return	NULL
+ */
+static void*
+logger(void *arg)
+{
+	uint32_t		i;
+	uint32_t		count;
+	uint64_t		overflows	=	0;
+	evrevent_t		events[FIFO_BURST*4];
+	log_t			*log		=	(log_t*)arg;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	while (true)
+	{
+		usleep(LOG_PERIOD*1000);
+
+		do
+		{
+			evr_receive(&log->subscriber, events, FIFO_BURST*4, &count);
+			if (log->subscriber.overflows != overflows)
+			{
+				fprintf(log->file, "# %llu events lost\n", (unsigned long long)(log->subscriber.overflows - overflows));
+				overflows	=	log->subscriber.overflows;
+			}
+			for (i = 0; i < count; i++)
+				fprintf(log->file, "%llu %u %u\n", (unsigned long long)events[i].sequence, events[i].code, events[i].stamp);
+		}
+		while (count == FIFO_BURST*4);
+
+		fflush(log->file);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Receives data buffers
+ *
+ * The receiver is polled every period. A received buffer is read as one batch of register reads into a buffer
+ * nobody holds, its checksum status being checked once, then it replaces the latest buffer and the records
+ * of the data buffers are scanned. The receiver is re-armed after each buffer.
+ *
+ * @param	arg	:	Pointer to the device receiving the buffers
+ * @return	NULL
+ */
+static void*
+receiver(void *arg)
+{
+	uint32_t	i;
+	uint32_t	size;
+	uint16_t	control;
+	IOSCANPVT	scan;
+	evrbuffer_t	*buffer;
+	evrbuffer_t	*previous;
+	request_t	requests[DATA_SIZE/2];
+	device_t	*device	=	(device_t*)arg;
+	databuf_t	*data	=	&device->data;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	/*Arm the receiver*/
+	pthread_mutex_lock(&device->mutex);
+	if (writereg(device, REGISTER_DATABUF_CONTROL, DATABUF_MODE | DATABUF_RECEIVE) < 0)
+		evr_log("[evr][receiver] Unable to arm data buffer receiver of %s\n", device->name);
+	pthread_mutex_unlock(&device->mutex);
+
+	while (true)
+	{
+		usleep(data->period*1000);
+
+		pthread_mutex_lock(&device->mutex);
+
+		/*Check for a buffer, the control register is volatile so it is never answered from the shadow copy*/
+		requests[0].access	=	ACCESS_READ;
+		requests[0].reg		=	REGISTER_DATABUF_CONTROL;
+		if (transfer(device, requests, 1) < 0)
+		{
+			pthread_mutex_unlock(&device->mutex);
+			continue;
+		}
+		control	=	requests[0].data;
+		if (!(control & DATABUF_READY) || (control & DATABUF_RECEIVE))
+		{
+			pthread_mutex_unlock(&device->mutex);
+			continue;
+		}
+
+		/*Find a buffer nobody holds*/
+		buffer	=	NULL;
+		pthread_mutex_lock(&data->mutex);
+		for (i = 0; i < DATA_BUFFERS && !buffer; i++)
+		{
+			if (!data->buffers[i].references)
+				buffer	=	&data->buffers[i];
+		}
+		if (control & DATABUF_CHECKSUM)
+			data->errors++;
+		else if (!buffer)
+			data->dropped++;
+		pthread_mutex_unlock(&data->mutex);
+
+		/*Read the buffer*/
+		size	=	control & DATABUF_SIZE;
+		if (size > DATA_SIZE)
+			size	=	DATA_SIZE;
+		if (buffer && !(control & DATABUF_CHECKSUM))
+		{
+			for (i = 0; i < (size + 1)/2; i++)
+			{
+				requests[i].access	=	ACCESS_READ;
+				requests[i].reg		=	REGISTER_DATABUF_DATA + i*2;
+			}
+			if (transfer(device, requests, (size + 1)/2) < 0)
+			{
+				pthread_mutex_lock(&data->mutex);
+				data->failures++;
+				pthread_mutex_unlock(&data->mutex);
+				buffer	=	NULL;
+			}
+			for (i = 0; buffer && i < (size + 1)/2; i++)
+			{
+				buffer->data[i*2]		=	requests[i].data >> 8;
+				buffer->data[i*2 + 1]	=	requests[i].data & 0xff;
+			}
+		}
+		else
+			buffer	=	NULL;
+
+		/*Re-arm the receiver*/
+		if (writereg(device, REGISTER_DATABUF_CONTROL, DATABUF_MODE | DATABUF_RECEIVE) < 0)
+			evr_log("[evr][receiver] Unable to arm data buffer receiver of %s\n", device->name);
+
+		pthread_mutex_unlock(&device->mutex);
+
+		if (!buffer)
+			continue;
+
+		/*Publish the buffer, the device holds its latest buffer*/
+		pthread_mutex_lock(&data->mutex);
+		buffer->size		=	size;
+		buffer->sequence	=	++data->received;
+		buffer->references	=	1;
+		previous			=	data->latest;
+		data->latest		=	buffer;
+		if (previous)
+			previous->references--;
+		scan				=	data->scan;
+		pthread_mutex_unlock(&data->mutex);
+
+		if (scan)
+			scanIoRequest(scan);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Samples the timestamp counter of a device
+ *
+ * The counter is read high word, low word, high word in one batch, and the sample is dropped
+ * if the low word wrapped in between. The sample is dated halfway through the batch.
+ * An advance of the counter that disagrees with the elapsed time by more than the batch duration and
+ * TIME_TOLERANCE is taken as a reset of the counter, and the extended counter is then continued from its extrapolation.
+ *
+ * @param	arg	:	Pointer to the device being sampled
+ * @return	NULL
+ */
+static void*
+sampler(void *arg)
+{
+	int32_t			status;
+	uint32_t		raw;
+	uint64_t		rate;
+	uint64_t		advance;
+	uint64_t		expected;
+	uint64_t		tolerance;
+	struct timespec	before;
+	struct timespec	after;
+	struct timespec	now;
+	request_t		requests[4];
+	device_t		*device		=	(device_t*)arg;
+	timebase_t		*timebase	=	&device->timebase;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	requests[0].access	=	ACCESS_READ;
+	requests[0].reg		=	REGISTER_TIME_HI;
+	requests[1].access	=	ACCESS_READ;
+	requests[1].reg		=	REGISTER_TIME_LO;
+	requests[2].access	=	ACCESS_READ;
+	requests[2].reg		=	REGISTER_TIME_HI;
+	requests[3].access	=	ACCESS_READ;
+	requests[3].reg		=	REGISTER_USEC_DIVIDER;
+
+	while (true)
+	{
+		pthread_mutex_lock(&device->mutex);
+		clock_gettime(CLOCK_MONOTONIC, &before);
+		status	=	transfer(device, requests, 4);
+		clock_gettime(CLOCK_MONOTONIC, &after);
+		pthread_mutex_unlock(&device->mutex);
+
+		if (status < 0 || requests[0].data != requests[2].data || !requests[3].data)
+		{
+			pthread_mutex_lock(&timebase->mutex);
+			timebase->errors	+=	(status < 0);
+			pthread_mutex_unlock(&timebase->mutex);
+			usleep(timebase->period*1000);
+			continue;
+		}
+		raw			=	(uint32_t)requests[0].data << 16 | requests[1].data;
+		rate		=	device->frequency*1000000ULL/requests[3].data;
+		tolerance	=	(elapsed(&before, &after) + TIME_TOLERANCE*1000000LL)*rate/1000000000LL;
+
+		/*Date the sample halfway through the batch*/
+		now			=	before;
+		now.tv_nsec	+=	elapsed(&before, &after)/2;
+		now.tv_sec	+=	now.tv_nsec/1000000000;
+		now.tv_nsec	%=	1000000000;
+
+		pthread_mutex_lock(&timebase->mutex);
+		if (!timebase->valid)
+		{
+			/*Anchor the counter to the host clock, the device does not know the date*/
+			clock_gettime(CLOCK_REALTIME, &after);
+			timebase->time		=	after.tv_sec*1000000000LL + after.tv_nsec;
+			timebase->ticks		=	raw;
+			timebase->valid		=	true;
+		}
+		else
+		{
+			/*Ticks since the last sample are counted at the rate of the last sample*/
+			expected	=	elapsed(&timebase->sampled, &now)*timebase->rate/1000000000LL;
+			advance		=	(uint32_t)(raw - timebase->raw);
+			if (advance + tolerance < expected || advance > expected + tolerance)
+			{
+				advance	=	expected;
+				timebase->resets++;
+			}
+			timebase->ticks	+=	advance;
+			timebase->time	+=	advance*1000000000LL/timebase->rate;
+		}
+		timebase->rate		=	rate;
+		timebase->raw		=	raw;
+		timebase->sampled	=	now;
+		timebase->samples++;
+		pthread_mutex_unlock(&timebase->mutex);
+
+		usleep(timebase->period*1000);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Converts a timestamp counter value to EPICS time
+ *
+ * Counter values are taken to lie within half a counter period of the last sample, and converted at the rate of the last sample.
+ * The current time is the time of the last sample plus the time elapsed since on the host monotonic clock.
+ *
+ * @param	*device	:	A pointer to the device being acted upon
+ * @param	current	:	Convert the current counter value, extrapolated from the last sample, rather than stamp
+ * @param	stamp	:	The counter value
+ * @param	*time	:	The converted time
+ * @return	0 on success, -1 if the counter was never sampled
+ */
+static long
+convert(device_t *device, bool current, uint32_t stamp, epicsTimeStamp *time)
+{
+	int64_t			nanoseconds;
+	struct timespec	now;
+	timebase_t		*timebase	=	&device->timebase;
+
+	pthread_mutex_lock(&timebase->mutex);
+	if (!timebase->valid)
+	{
+		pthread_mutex_unlock(&timebase->mutex);
+		return -1;
+	}
+	if (current)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		nanoseconds	=	timebase->time + elapsed(&timebase->sampled, &now);
+	}
+	else
+		nanoseconds	=	timebase->time + (int64_t)(int32_t)(stamp - timebase->raw)*1000000000LL/(int64_t)timebase->rate;
+	pthread_mutex_unlock(&timebase->mutex);
+
+	now.tv_sec	=	nanoseconds/1000000000LL;
+	now.tv_nsec	=	nanoseconds%1000000000LL;
+	epicsTimeFromTimespec(time, &now);
+
+	return 0;
+}
+
+/**
+ * @brief	generalTime current time provider, see evrConfigureTime
+ *
+ * The VME-EVR-230 supplies no seconds, only a counter at the rate of the event clock, anchored once to the host clock.
+ * The provider is therefore registered after the OS clock, as a fallback for when the OS clock fails.
+ *
+ * @param	*time	:	The current time
+ * @return	epicsTimeOK on success, epicsTimeERROR if the time is not known
+ */
+static int
+currentTime(epicsTimeStamp *time)
+{
+	if (!timekeeper || convert(timekeeper, true, 0, time) < 0)
+		return epicsTimeERROR;
+
+	return epicsTimeOK;
+}
+
+/**
+ * @brief	generalTime event time provider, see evrConfigureTime
+ *
+ * Event numbers 1 to 255 are event codes, and give the time the last event of the code was received at.
+ *
+ * @param	*time	:	The time of the event
+ * @param	event	:	The event number
+ * @return	epicsTimeOK on success, epicsTimeERROR if the time is not known
+ */
+static int
+eventTime(epicsTimeStamp *time, int event)
+{
+	if (!timekeeper)
+		return epicsTimeERROR;
+	if (event == epicsTimeEventCurrentTime)
+		return currentTime(time);
+	if (event <= 0 || event >= NUMBER_OF_EVENTS || evr_getEventTime(timekeeper, event, time) < 0)
+		return epicsTimeERROR;
+
+	return epicsTimeOK;
+}
+
+/**
+ * @brief	Returns the number of nanoseconds elapsed between two times
+ */
+static uint64_t
+elapsed(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec)*1000000000LL + (end->tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief	Executes jobs queued to the device, one at a time
+ *
+ * @param	arg	:	Pointer to the device served by the worker
+ * @return	NULL
+ */
+static void*
+worker(void *arg)
+{
+	job_t			job;
+	struct timespec	start;
+	struct timespec	end;
+	device_t		*device	=	(device_t*)arg;
+
+	/*Detach thread*/
+	pthread_detach(pthread_self());
+
+	while (true)
+	{
+		/*Wait for a job*/
+		pthread_mutex_lock(&device->queue.mutex);
+		while (!device->queue.depth)
+			pthread_cond_wait(&device->queue.condition, &device->queue.mutex);
+		job					=	device->queue.jobs[device->queue.head];
+		device->queue.head	=	(device->queue.head + 1)%QUEUE_SIZE;
+		device->queue.depth--;
+		pthread_mutex_unlock(&device->queue.mutex);
+
+		/*Execute it*/
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		reason	=	job.error;
+		job.function(job.arg);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		/*Account for it*/
+		pthread_mutex_lock(&device->queue.mutex);
+		device->queue.processed++;
+		device->queue.wait		+=	elapsed(&job.queued, &start);
+		device->queue.service	+=	elapsed(&start, &end);
+		if (elapsed(&job.queued, &end) > device->queue.worst)
+			device->queue.worst	=	elapsed(&job.queued, &end);
+		pthread_mutex_unlock(&device->queue.mutex);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Reports on all configured devices
+ *
+ * @param	detail	:	Level of detail requested
+ * @return	0 on success, -1 on failure
+ */
+static long
+report(int detail)
+{
+	uint32_t		i;
+	uint32_t		api;
+	evrstats_t		stats;
+	struct in_addr	address;
+
+	for (i = 0; i < deviceCount; i++)
+	{
+		printf("===Start of EVR Device Report===\n");
+		address.s_addr	=	devices[i]->ip;
+		printf("Found %s @ %s (%s):%u\n", devices[i]->name, devices[i]->host, inet_ntoa(address), ntohs(devices[i]->port));
+		if (detail > 0)
+		{
+			printf("Cache: maximum age %ums, refresh period %ums\n", devices[i]->age, devices[i]->refresh);
+			printf("Poller: period %ums\n", devices[i]->poll);
+			printf("Event FIFO: period %ums, events %llu, reads %llu, failed reads %llu\n", devices[i]->fifo.period,
+				(unsigned long long)__atomic_load_n(&devices[i]->fifo.head, __ATOMIC_ACQUIRE), (unsigned long long)devices[i]->fifo.reads, (unsigned long long)devices[i]->fifo.errors);
+			pthread_mutex_lock(&devices[i]->data.mutex);
+			printf("Data buffers: period %ums, received %llu, checksum errors %llu, failed reads %llu, dropped %llu\n", devices[i]->data.period,
+				(unsigned long long)devices[i]->data.received, (unsigned long long)devices[i]->data.errors,
+				(unsigned long long)devices[i]->data.failures, (unsigned long long)devices[i]->data.dropped);
+			pthread_mutex_unlock(&devices[i]->data.mutex);
+			pthread_mutex_lock(&devices[i]->timebase.mutex);
+			printf("Time: period %ums, %s, rate %lluHz, samples %llu, failed samples %llu, resets %llu\n", devices[i]->timebase.period,
+				devices[i] == timekeeper ? "provider" : "not provider", (unsigned long long)devices[i]->timebase.rate, (unsigned long long)devices[i]->timebase.samples,
+				(unsigned long long)devices[i]->timebase.errors, (unsigned long long)devices[i]->timebase.resets);
+			pthread_mutex_unlock(&devices[i]->timebase.mutex);
+			pthread_mutex_lock(&devices[i]->mutex);
+			printf("Verification: %s, period %ums, pending %u\n", (devices[i]->verify == VERIFY_DEFERRED) ? "deferred" : "immediate",
+				devices[i]->interval, devices[i]->checks);
+			pthread_mutex_unlock(&devices[i]->mutex);
+			printf("Recorder: transactions %llu, kept %u\n", (unsigned long long)__atomic_load_n(&devices[i]->recorder.head, __ATOMIC_ACQUIRE), RECORDER_SIZE);
+			pthread_mutex_lock(&devices[i]->queue.mutex);
+			printf("Queue: depth %u, peak %u, processed %llu, rejected %llu\n", devices[i]->queue.depth, devices[i]->queue.peak,
+				(unsigned long long)devices[i]->queue.processed, (unsigned long long)devices[i]->queue.rejected);
+			if (devices[i]->queue.processed)
+				printf("Queue: average wait %.3fms, average service %.3fms, worst latency %.3fms\n",
+					devices[i]->queue.wait/(devices[i]->queue.processed*1e6), devices[i]->queue.service/(devices[i]->queue.processed*1e6), devices[i]->queue.worst/1e6);
+			pthread_mutex_unlock(&devices[i]->queue.mutex);
+			pthread_mutex_lock(&devices[i]->lock);
+			printf("State: %s\n", devices[i]->state == STATE_ONLINE ? "online" : (devices[i]->state == STATE_OFFLINE ? "offline" : "starting"));
+			printf("Link: srtt %.3fms, rttvar %.3fms, timeout %.3fms, retransmits %llu, failures %llu\n", devices[i]->srtt/1e3, devices[i]->rttvar/1e3,
+				devices[i]->rto/1e3, (unsigned long long)devices[i]->retransmits, (unsigned long long)devices[i]->failures);
+			printf("Link: stale replies %llu, malformed replies %llu\n", (unsigned long long)devices[i]->stale, (unsigned long long)devices[i]->malformed);
+			pthread_mutex_unlock(&devices[i]->lock);
+		}
+		if (detail > 1)
+		{
+			for (api = 0; api < NUMBER_OF_APIS; api++)
+			{
+				if (evr_getApiStats(devices[i], apiNames[api], &stats) < 0 || !stats.calls)
+					continue;
+				printf("API %s: calls %llu, failures %llu, retries %llu, average wait %.3fms, wire %.3fms, latency %.3fms, 99th percentile below %.3fms\n",
+					apiNames[api], (unsigned long long)stats.calls, (unsigned long long)stats.failures, (unsigned long long)stats.retries,
+					stats.wait/(stats.calls*1e6), stats.wire/(stats.calls*1e6), stats.total/(stats.calls*1e6), stats.tail/1e6);
+			}
+		}
+	}
+		printf("===End of EVR Device Report===\n\n");
+
+	return 0;
+}
+
+/*
+ * Configuration and registration functions and variables
+ */
+static 	const 	iocshArg		configureArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		configureArg1 	= 	{ "ip",			iocshArgString };
+static 	const 	iocshArg		configureArg2 	= 	{ "port",		iocshArgString };
+static 	const 	iocshArg		configureArg3 	= 	{ "frequency", 	iocshArgString };
+static 	const 	iocshArg*		configureArgs[] = 
+{
+    &configureArg0,
+    &configureArg1,
+    &configureArg2,
+    &configureArg3,
+};
+static	const	iocshFuncDef	configureDef	=	{ "evrConfigure", 4, configureArgs };
+static 	long	configure(char *name, char *ip, char* port, char* frequency)
+{
+	device_t		**table;
+	device_t		*device;
+
+	if (!name || !strlen(name) || strlen(name) >= NAME_LENGTH)
+	{
+		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect name\r\n\x1B[0m");
+		return -1;
+	}
+	if (evr_open(name))
+	{
+		printf("\x1B[31m[evr][] Unable to configure device: Device already configured\r\n\x1B[0m");
+		return -1;
+	}
+	if (!ip || !strlen(ip) || strlen(ip) >= HOST_LENGTH)
+	{
+		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect ip\r\n\x1B[0m");
+		return -1;
+	}
+	if (!port || !strlen(port) || !atoi(port) || atoi(port) > USHRT_MAX)
+	{
+		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect port\r\n\x1B[0m");
+		return -1;
+	}
+	if (!frequency || !strlen(frequency) || !atoi(frequency))
+	{
+		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect name\r\n\x1B[0m");
+		return -1;
+	}
+
+	/*Devices are allocated one by one so that the pointers handed out by evr_open stay valid as the table grows*/
+	if (deviceCount >= deviceSize)
+	{
+		table	=	realloc(devices, (deviceSize ? deviceSize*2 : NUMBER_OF_BUCKETS)*sizeof(device_t*));
+		if (!table)
+		{
+			printf("\x1B[31m[evr][] Unable to configure device: Out of memory\r\n\x1B[0m");
+			return -1;
+		}
+		devices		=	table;
+		deviceSize	=	deviceSize ? deviceSize*2 : NUMBER_OF_BUCKETS;
+	}
+	if (posix_memalign((void**)&device, CACHE_LINE, sizeof(device_t)))
+	{
+		printf("\x1B[31m[evr][] Unable to configure device: Out of memory\r\n\x1B[0m");
+		return -1;
+	}
+	memset(device, 0, sizeof(device_t));
+
+	/*The host name is resolved by init, together with the other devices*/
+	strcpy(device->host,	ip);
+	device->ip	=	INADDR_NONE;
+
+	strcpy(device->name, 	name);
+	device->port		=	htons(atoi(port));
+	device->frequency	=	atoi(frequency);
+
+	/*Initialize mutexes, configuration commands may take them before init*/
+	pthread_mutex_init(&device->mutex, NULL);
+	pthread_mutex_init(&device->timebase.mutex, NULL);
+	pthread_mutex_init(&device->data.mutex, NULL);
+	pthread_mutex_init(&device->queue.mutex, NULL);
+	pthread_cond_init(&device->queue.condition, NULL);
+	pthread_mutex_init(&device->lock, NULL);
+	pthread_cond_init(&device->completion, NULL);
+	pthread_cond_init(&device->lost, NULL);
+
+	/*The device cannot be reached until init creates its socket and starts the reactor, requests fail at once until then*/
+	device->socket	=	-1;
+	device->state	=	STATE_OFFLINE;
+
+	if (insert(device) < 0)
+	{
+		printf("\x1B[31m[evr][] Unable to configure device: Out of memory\r\n\x1B[0m");
+		free(device);
+		return -1;
+	}
+	devices[deviceCount++]	=	device;
+
+	return 0;
+}
+
+static void configureFunc (const iocshArgBuf *args)
+{
+    configure(args[0].sval, args[1].sval, args[2].sval, args[3].sval);
+}
+
+static 	const 	iocshArg		cacheArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		cacheArg1 	= 	{ "age",		iocshArgString };
+static 	const 	iocshArg		cacheArg2 	= 	{ "refresh",	iocshArgString };
+static 	const 	iocshArg*		cacheArgs[] = 
+{
+    &cacheArg0,
+    &cacheArg1,
+    &cacheArg2,
+};
+static	const	iocshFuncDef	cacheDef	=	{ "evrConfigureCache", 3, cacheArgs };
+static 	long	cache(char *name, char *age, char *refresh)
+{
+	device_t	*device;
+
+	device	=	evr_open(name);
+	if (!device)
+	{
+		printf("\x1B[31m[evr][] Unable to configure cache: Device not found\r\n\x1B[0m");
+		return -1;
+	}
+	if (!age || !strlen(age) || atoi(age) < 0)
+	{
+		printf("\x1B[31m[evr][] Unable to configure cache: Missing or incorrect age\r\n\x1B[0m");
+		return -1;
+	}
+	if (!refresh || !strlen(refresh) || atoi(refresh) < 0)
+	{
+		printf("\x1B[31m[evr][] Unable to configure cache: Missing or incorrect refresh period\r\n\x1B[0m");
+		return -1;
+	}
+
+	device->age		=	atoi(age);
+	device->refresh	=	atoi(refresh);
+
+	return 0;
+}
+
+static void cacheFunc (const iocshArgBuf *args)
+{
+    cache(args[0].sval, args[1].sval, args[2].sval);
+}
+
+static 	const 	iocshArg		refreshArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg*		refreshArgs[] = 
+{
+    &refreshArg0,
+};
+static	const	iocshFuncDef	refreshDef	=	{ "evrRefresh", 1, refreshArgs };
+
+static void refreshFunc (const iocshArgBuf *args)
+{
+	void	*device	=	evr_open(args[0].sval);
+
+	if (!device)
+	{
+		printf("\x1B[31m[evr][] Unable to refresh: Device not found\r\n\x1B[0m");
+		return;
+	}
+	if (!initialized)
+	{
+		printf("\x1B[31m[evr][] Unable to refresh: Devices cannot be reached before iocInit\r\n\x1B[0m");
+		return;
+	}
+	if (evr_refresh(device) < 0)
+		printf("\x1B[31m[evr][] Unable to refresh: Could not read registers\r\n\x1B[0m");
+}
+
+static 	const 	iocshArg		verifyArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		verifyArg1 	= 	{ "mode",		iocshArgString };
+static 	const 	iocshArg		verifyArg2 	= 	{ "period",		iocshArgString };
+static 	const 	iocshArg*		verifyArgs[] = 
+{
+    &verifyArg0,
+    &verifyArg1,
+    &verifyArg2,
+};
+static	const	iocshFuncDef	verifyDef	=	{ "evrConfigureVerify", 3, verifyArgs };
+static 	long	configureVerify(char *name, char *mode, char *period)
+{
+	device_t	*device;
+
+	device	=	evr_open(name);
+	if (!device)
+	{
+		printf("\x1B[31m[evr][configureVerify] Unable to configure verification: Device not found\r\n\x1B[0m");
+		return -1;
+	}
+	if (!mode || (strcmp(mode, "immediate") != 0 && strcmp(mode, "deferred") != 0))
+	{
+		printf("\x1B[31m[evr][configureVerify] Unable to configure verification: Mode must be immediate or deferred\r\n\x1B[0m");
+		return -1;
+	}
+	/*Without a period, deferred writes are read back when the calling function completes*/
+	if (period && strlen(period) && atoi(period) <= 0)
+	{
+		printf("\x1B[31m[evr][configureVerify] Unable to configure verification: Incorrect period\r\n\x1B[0m");
+		return -1;
+	}
+
+	pthread_mutex_lock(&device->mutex);
+	device->verify		=	(strcmp(mode, "deferred") == 0) ? VERIFY_DEFERRED : VERIFY_IMMEDIATE;
+	device->interval	=	(device->verify == VERIFY_DEFERRED && period && strlen(period)) ? atoi(period) : 0;
+	verify(device);
+	pthread_mutex_unlock(&device->mutex);
+
+	return 0;
+}
+
+static void verifyFunc (const iocshArgBuf *args)
+{
+    configureVerify(args[0].sval, args[1].sval, args[2].sval);
+}
+
+static 	const 	iocshArg		resolverArg0 	= 	{ "file",		iocshArgString };
+static 	const 	iocshArg		resolverArg1 	= 	{ "period",		iocshArgString };
+static 	const 	iocshArg*		resolverArgs[] = 
+{
+    &resolverArg0,
+    &resolverArg1,
+};
+static	const	iocshFuncDef	resolverDef	=	{ "evrConfigureResolver", 2, resolverArgs };
+static 	long	configureResolver(char *file, char *period)
+{
+	if (file && strlen(file) >= PATH_MAX)
+	{
+		printf("\x1B[31m[evr][] Unable to configure resolver: File name too long\r\n\x1B[0m");
+		return -1;
+	}
+	if (period && strlen(period) && atoi(period) < 0)
+	{
+		printf("\x1B[31m[evr][] Unable to configure resolver: Incorrect period\r\n\x1B[0m");
+		return -1;
+	}
+
+	strcpy(addressFile, file ? file : "");
+	resolvePeriod	=	(period && strlen(period)) ? atoi(period) : 0;
+
+	return 0;
+}
+
+static void resolverFunc (const iocshArgBuf *args)
+{
+    configureResolver(args[0].sval, args[1].sval);
+}
+
+static 	const 	iocshArg		fifoArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		fifoArg1 	= 	{ "period",		iocshArgString };
+static 	const 	iocshArg*		fifoArgs[] = 
+{
+    &fifoArg0,
+    &fifoArg1,
+};
+static	const	iocshFuncDef	fifoDef	=	{ "evrConfigureFifo", 2, fifoArgs };
+static 	long	configureFifo(char *name, char *period)
+{
+	device_t	*device;
 
-	/*Check inputs*/
-	if (!dev || !version)
+	device	=	evr_open(name);
+	if (!device)
 	{
-		printf("\x1B[31m[evr][getFirmwareVersion] Null pointer.\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		printf("\x1B[31m[evr][] Unable to configure event FIFO: Device not found\r\n\x1B[0m");
 		return -1;
 	}
-
-	status	=	readreg(device, REGISTER_FIRMWARE, version);
-	if (status < 0)
+	if (!period || !strlen(period) || atoi(period) < 0)
 	{
-		printf("\x1B[31m[evr][getFirmwareVersion] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		printf("\x1B[31m[evr][] Unable to configure event FIFO: Missing or incorrect period\r\n\x1B[0m");
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	device->fifo.period	=	atoi(period);
 
 	return 0;
 }
 
-/**
- * @brief	Resets the rx violation flag.
- *
- * @param	*dev	:	A pointer to the device being acted upon
- * @return	0 on success, -1 on failure
- */
-long
-evr_resetRxViolation(void* dev)
+static void fifoFunc (const iocshArgBuf *args)
 {
-	uint16_t	data;
-	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
+    configureFifo(args[0].sval, args[1].sval);
+}
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+static 	const 	iocshArg		dataArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		dataArg1 	= 	{ "period",		iocshArgString };
+static 	const 	iocshArg*		dataArgs[] = 
+{
+    &dataArg0,
+    &dataArg1,
+};
+static	const	iocshFuncDef	dataDef	=	{ "evrConfigureData", 2, dataArgs };
+static 	long	configureData(char *name, char *period)
+{
+	uint32_t	i;
+	device_t	*device;
 
-	/*Check inputs*/
-	if (!dev)
+	device	=	evr_open(name);
+	if (!device)
 	{
-		printf("\x1B[31m[evr][clearRxViolation] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		printf("\x1B[31m[evr][] Unable to configure data buffers: Device not found\r\n\x1B[0m");
 		return -1;
 	}
-
-	/*Read control register*/
-	status	=	readreg(device, REGISTER_CONTROL, &data);
-	if (status < 0)
+	if (!period || !strlen(period) || atoi(period) < 0)
 	{
-		printf("\x1B[31m[evr][clearRxViolation] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		printf("\x1B[31m[evr][] Unable to configure data buffers: Missing or incorrect period\r\n\x1B[0m");
 		return -1;
 	}
 
-	status	=	writereg(device, REGISTER_CONTROL, data|CONTROL_RXVIO);
-	if (status < 0)
+	if (!device->data.buffers)
 	{
-		printf("\x1B[31m[evr][clearRxVio] Couldn't write to control register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
-		return -1;
+		if (posix_memalign((void**)&device->data.buffers, CACHE_LINE, DATA_BUFFERS*sizeof(evrbuffer_t)))
+		{
+			device->data.buffers	=	NULL;
+			printf("\x1B[31m[evr][] Unable to configure data buffers: Out of memory\r\n\x1B[0m");
+			return -1;
+		}
+		memset(device->data.buffers, 0, DATA_BUFFERS*sizeof(evrbuffer_t));
+		for (i = 0; i < DATA_BUFFERS; i++)
+			device->data.buffers[i].device	=	device;
 	}
-
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	device->data.period	=	atoi(period);
 
 	return 0;
 }
 
-/**
- * @brief	Tests if rx violation flag is set.
- *
- * @param	*dev	:	A pointer to the device being acted upon
- * @return	0 for false, 1 for true, -1 on failure
- */
-long
-evr_isRxViolation(void* dev)
+static void dataFunc (const iocshArgBuf *args)
 {
-	uint16_t	data	=	0;
-	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
+    configureData(args[0].sval, args[1].sval);
+}
 
-	/*Lock mutex*/
-	pthread_mutex_lock(&device->mutex);
+static 	const 	iocshArg		timeArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		timeArg1 	= 	{ "period",		iocshArgString };
+static 	const 	iocshArg*		timeArgs[] = 
+{
+    &timeArg0,
+    &timeArg1,
+};
+static	const	iocshFuncDef	timeDef	=	{ "evrConfigureTime", 2, timeArgs };
+static 	long	configureTime(char *name, char *period)
+{
+	device_t	*device;
 
-	/*Check inputs*/
-	if (!dev)
+	device	=	evr_open(name);
+	if (!device)
 	{
-		printf("\x1B[31m[evr][isRxViolation] Null pointer to device\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+		printf("\x1B[31m[evr][] Unable to configure time: Device not found\r\n\x1B[0m");
 		return -1;
 	}
-
-	status	=	readreg(device, REGISTER_CONTROL, &data);
-	if (status < 0)
-	{ 
-		printf("\x1B[31m[evr][isRxViolation] Couldn't read register\n\x1B[0m");
-		pthread_mutex_unlock(&device->mutex);
+	if (!period || !strlen(period) || atoi(period) <= 0)
+	{
+		printf("\x1B[31m[evr][] Unable to configure time: Missing or incorrect period\r\n\x1B[0m");
+		return -1;
+	}
+	if (timekeeper)
+	{
+		printf("\x1B[31m[evr][] Unable to configure time: Time is already provided by %s\r\n\x1B[0m", timekeeper->name);
 		return -1;
 	}
 
-	/*Unlock mutex*/
-	pthread_mutex_unlock(&device->mutex);
+	device->timebase.period	=	atoi(period);
+	timekeeper				=	device;
+	generalTimeRegisterCurrentProvider("evr", CURRENT_PRIORITY, currentTime);
+	generalTimeRegisterEventProvider("evr", TIME_PRIORITY, eventTime);
 
-	return (data&CONTROL_RXVIO);
+	return 0;
 }
 
-/**
- * @brief	Writes device's 16-bit register and checks the register was written
- *
- * Prepares UDP message, sends it to device
- * Reads back the value in the register and validates the write
- *
- * @param	*dev	:	A pointer to the device being acted upon
- * @param	reg		:	Address of register to be written
- * @param	data	:	16-bit data to be written to device
- * @return	0 on success, -1 on failure
- */
-static long	
-writecheck(void *dev, evrregister_t reg, uint16_t data)
+static void timeFunc (const iocshArgBuf *args)
+{
+    configureTime(args[0].sval, args[1].sval);
+}
+
+static 	const 	iocshArg		logArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		logArg1 	= 	{ "file",		iocshArgString };
+static 	const 	iocshArg*		logArgs[] = 
+{
+    &logArg0,
+    &logArg1,
+};
+static	const	iocshFuncDef	logDef	=	{ "evrLogEvents", 2, logArgs };
+static 	long	logEvents(char *name, char *file)
 {
-	uint16_t	readback;
 	int32_t		status;
-	device_t	*device	=	(device_t*)dev;
+	device_t	*device;
+	log_t		*log;
+	pthread_t	handle;
 
-	/*Check inputs*/
-	if (!dev)
+	device	=	evr_open(name);
+	if (!device)
+	{
+		printf("\x1B[31m[evr][] Unable to log events: Device not found\r\n\x1B[0m");
 		return -1;
-
-	/*Write data*/
-	status	=	writereg(device, reg, data);
-	if (status < 0)
+	}
+	if (!file || !strlen(file))
+	{
+		printf("\x1B[31m[evr][] Unable to log events: Missing file\r\n\x1B[0m");
 		return -1;
+	}
 
-	/*Check that data was updated*/
-	status	=	readreg(device, reg, &readback);
-	if (status < 0)
+	if (posix_memalign((void**)&log, CACHE_LINE, sizeof(log_t)))
+	{
+		printf("\x1B[31m[evr][] Unable to log events: Out of memory\r\n\x1B[0m");
+		return -1;
+	}
+	log->file	=	fopen(file, "a");
+	if (!log->file)
+	{
+		printf("\x1B[31m[evr][] Unable to log events: Could not open %s\r\n\x1B[0m", file);
+		free(log);
 		return -1;
+	}
+	evr_subscribe(device, &log->subscriber);
 
-	if (readback != data)
+	status	=	pthread_create(&handle, NULL, logger, log);
+	if (status)
+	{
+		printf("\x1B[31m[evr][] Unable to log events: Could not start logger\r\n\x1B[0m");
+		fclose(log->file);
+		free(log);
 		return -1;
+	}
 
 	return 0;
 }
 
-/**
- * @brief	Reads 16-bit register from device
- *
- * Prepares UDP message, sends it to device, and reads back reply.
- * Times out and retransmits upon detecting any communication failures.
- *
- * @param	*dev	:	A pointer to the device being acted upon
- * @param	reg		:	Address of register to be read
- * @param	*data	:	16-bit data read from register
- * @return	0 on success, -1 on failure
- */
-static long
-readreg(void *dev, evrregister_t reg, uint16_t *data)
+static void logFunc (const iocshArgBuf *args)
 {
-	int32_t			status;
-	uint32_t		retries;
-	message_t		message;
-	device_t		*device	=	(device_t*)dev;
-	struct pollfd	events[1];
+    logEvents(args[0].sval, args[1].sval);
+}
 
-	/*Check inputs*/
-	if (!dev || !data)
-		return -1;
+static 	const 	iocshArg		tapArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		tapArg1 	= 	{ "count",		iocshArgString };
+static 	const 	iocshArg*		tapArgs[] = 
+{
+    &tapArg0,
+    &tapArg1,
+};
+static	const	iocshFuncDef	tapDef	=	{ "evrTapEvents", 2, tapArgs };
+static 	long	tapEvents(char *name, char *count)
+{
+	uint32_t		i;
+	uint32_t		received;
+	uint32_t		printed		=	0;
+	uint32_t		wanted;
+	uint32_t		waited		=	0;
+	device_t		*device;
+	evrsubscriber_t	subscriber;
+	evrevent_t		events[FIFO_BURST];
 
-	/*Prepare message*/
-	message.access		=	ACCESS_READ;
-	message.status		=	0;
-	message.data		=	0x0000;
-	message.address		=	htonl(REGISTER_BASE_ADDRESS + reg);
-	message.reference	=	0x00000000;
+	device	=	evr_open(name);
+	if (!device)
+	{
+		printf("\x1B[31m[evr][] Unable to tap events: Device not found\r\n\x1B[0m");
+		return -1;
+	}
+	wanted	=	(count && strlen(count) && atoi(count) > 0) ? atoi(count) : 10;
 
-	for (retries = 0; retries < NUMBER_OF_RETRIES; retries++)
+	/*Print the next events, giving up after TAP_TIMEOUT without any*/
+	evr_subscribe(device, &subscriber);
+	while (printed < wanted && waited < TAP_TIMEOUT*1000)
 	{
-		/*Write to device*/
-		status	=	write(device->socket, &message, sizeof(message));
-		if (status == sizeof(message))
+		evr_receive(&subscriber, events, (wanted - printed < FIFO_BURST) ? wanted - printed : FIFO_BURST, &received);
+		for (i = 0; i < received; i++)
+			printf("%llu %u %u\r\n", (unsigned long long)events[i].sequence, events[i].code, events[i].stamp);
+		printed	+=	received;
+		if (received)
+			waited	=	0;
+		else
 		{
-			/*Prepare poll structure*/
-			events[0].fd		=	device->socket;	
-			events[0].events	=	POLLIN;
-			events[0].revents	=	0;
-
-			/*Poll*/
-			status	=	poll(events, 1, 1000);
-			if (status > 0) /*Ready to read (no errors or timeouts)*/
-			{
-				/*Read from device*/
-				status	=	read(device->socket, &message, sizeof(message));
-				if (status == sizeof(message))
-					break;
-			}
+			usleep(LOG_PERIOD*1000);
+			waited	+=	LOG_PERIOD;
 		}
 	}
-
-	if (retries >= NUMBER_OF_RETRIES)
-		return -1;
-
-	/*Extract data*/
-	*data	=	ntohs(message.data);
+	if (subscriber.overflows)
+		printf("%llu events lost\r\n", (unsigned long long)subscriber.overflows);
 
 	return 0;
 }
 
-/**
- * @brief	Writes device's 16-bit register
- *
- * Prepares UDP message, sends it to device, and reads back reply.
- * Times out and retransmits upon detecting any communication failures.
- *
- * @param	*dev	:	A pointer to the device being acted upon
- * @param	reg		:	Address of register to be read
- * @param	data	:	16-bit data to be written to device
- * @return	0 on success, -1 on failure
- */
-static long
-writereg(void *dev, evrregister_t reg, uint16_t data)
+static void tapFunc (const iocshArgBuf *args)
 {
-	int32_t			status;
-	uint32_t		retries;
-	message_t		message;
-	device_t		*device	=	(device_t*)dev;
-	struct pollfd	events[1];
+    tapEvents(args[0].sval, args[1].sval);
+}
 
-	if (!dev)
+static 	const 	iocshArg		dumpArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		dumpArg1 	= 	{ "count",		iocshArgString };
+static 	const 	iocshArg		dumpArg2 	= 	{ "file",		iocshArgString };
+static 	const 	iocshArg*		dumpArgs[] = 
+{
+    &dumpArg0,
+    &dumpArg1,
+    &dumpArg2,
+};
+static	const	iocshFuncDef	dumpDef	=	{ "evrDumpTransactions", 3, dumpArgs };
+static 	long	dumpTransactions(char *name, char *count, char *file)
+{
+	uint32_t			i;
+	uint32_t			wanted;
+	uint32_t			kept;
+	time_t				seconds;
+	struct tm			date;
+	char				text[32];
+	FILE				*dump;
+	device_t			*device;
+	evrtransaction_t	*transactions;
+
+	device	=	evr_open(name);
+	if (!device)
+	{
+		printf("\x1B[31m[evr][] Unable to dump transactions: Device not found\r\n\x1B[0m");
 		return -1;
+	}
 
-	/*Prepare message*/
-	message.access		=	ACCESS_WRITE;
-	message.status		=	0;
-	message.data		=	htons(data);
-	message.address		=	htonl(REGISTER_BASE_ADDRESS + reg);
-	message.reference	=	0x00000000;
+	/*The console gets the last few transactions, files the whole recorder unless told otherwise*/
+	wanted	=	(file && strlen(file)) ? RECORDER_SIZE : DUMP_COUNT;
+	if (count && strlen(count) && atoi(count) > 0)
+		wanted	=	(atoi(count) < RECORDER_SIZE) ? atoi(count) : RECORDER_SIZE;
 
-	/*Transmit and retry*/
-	for (retries = 0; retries < NUMBER_OF_RETRIES; retries++)
+	transactions	=	malloc(wanted*sizeof(evrtransaction_t));
+	if (!transactions)
 	{
-		/*Write to device*/
-		status	=	write(device->socket, &message, sizeof(message));
-		if (status == sizeof(message))
-		{
-			/*Prepare poll structure*/
-			events[0].fd		=	device->socket;	
-			events[0].events	=	POLLIN;
-			events[0].revents	=	0;
+		printf("\x1B[31m[evr][] Unable to dump transactions: Out of memory\r\n\x1B[0m");
+		return -1;
+	}
+	evr_getTransactions(device, transactions, wanted, &kept);
 
-			/*Poll*/
-			status	=	poll(events, 1, 1000);
-			if (status > 0)
-			{
-				/*Read from device*/
-				status	=	read(device->socket, &message, sizeof(message));
-				if (status == sizeof(message))
-					break;
-			}
+	if (file && strlen(file))
+	{
+		dump	=	fopen(file, "wb");
+		if (!dump)
+		{
+			printf("\x1B[31m[evr][] Unable to dump transactions: Could not open %s\r\n\x1B[0m", file);
+			free(transactions);
+			return -1;
 		}
+		if (fwrite(transactions, sizeof(evrtransaction_t), kept, dump) != kept)
+			printf("\x1B[31m[evr][] Unable to dump transactions: Could not write %s\r\n\x1B[0m", file);
+		fclose(dump);
+		printf("%u transactions written to %s\r\n", kept, file);
+		free(transactions);
+		return 0;
 	}
 
-	if (retries >= NUMBER_OF_RETRIES)
-		return -1;
+	for (i = 0; i < kept; i++)
+	{
+		seconds	=	transactions[i].time/1000000000LL;
+		localtime_r(&seconds, &date);
+		strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &date);
+		printf("%llu %s.%06lld %s 0x%02x 0x%04x retries %u latency %uus %s\r\n", (unsigned long long)transactions[i].sequence,
+			text, (long long)(transactions[i].time%1000000000LL)/1000, (transactions[i].access == ACCESS_WRITE) ? "write" : "read ",
+			transactions[i].reg, transactions[i].data, transactions[i].retries, transactions[i].latency,
+			(transactions[i].status < 0) ? "timeout" : "ok");
+	}
+	free(transactions);
 
 	return 0;
 }
 
-/**
- * @brief	Reports on all configured devices
- *
- * @param	detail	:	Level of detail requested
- * @return	0 on success, -1 on failure
- */
-static long
-report(int detail)
+static void dumpFunc (const iocshArgBuf *args)
 {
-	uint32_t		i;
-	struct in_addr	address;
-
-	for (i = 0; i < deviceCount; i++)
-	{
-		printf("===Start of EVR Device Report===\n");
-		address.s_addr	=	devices[i].ip;
-		printf("Found %s @ %s:%u\n", devices[i].name, inet_ntoa(address), ntohs(devices[i].port));
-	}
-		printf("===End of EVR Device Report===\n\n");
-
-	return 0;
+    dumpTransactions(args[0].sval, args[1].sval, args[2].sval);
 }
 
-/*
- * Configuration and registration functions and variables
- */
-static 	const 	iocshArg		configureArg0 	= 	{ "name",		iocshArgString };
-static 	const 	iocshArg		configureArg1 	= 	{ "ip",			iocshArgString };
-static 	const 	iocshArg		configureArg2 	= 	{ "port",		iocshArgString };
-static 	const 	iocshArg		configureArg3 	= 	{ "frequency", 	iocshArgString };
-static 	const 	iocshArg*		configureArgs[] = 
+static 	const 	iocshArg		pollArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		pollArg1 	= 	{ "period",		iocshArgString };
+static 	const 	iocshArg*		pollArgs[] = 
 {
-    &configureArg0,
-    &configureArg1,
-    &configureArg2,
-    &configureArg3,
+    &pollArg0,
+    &pollArg1,
 };
-static	const	iocshFuncDef	configureDef	=	{ "evrConfigure", 4, configureArgs };
-static 	long	configure(char *name, char *ip, char* port, char* frequency)
+static	const	iocshFuncDef	pollDef	=	{ "evrConfigurePoll", 2, pollArgs };
+static 	long	configurePoll(char *name, char *period)
 {
-	struct	hostent *hostentry;
-	struct	in_addr **addr_list;
+	device_t	*device;
 
-	if (deviceCount >= NUMBER_OF_DEVICES)
-	{
-		printf("\x1B[31m[evr][] Unable to configure device: Too many devices\r\n\x1B[0m");
-		return -1;
-	}
-	if (!name || !strlen(name) || strlen(name) >= NAME_LENGTH)
+	device	=	evr_open(name);
+	if (!device)
 	{
-		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect name\r\n\x1B[0m");
+		printf("\x1B[31m[evr][] Unable to configure poller: Device not found\r\n\x1B[0m");
 		return -1;
 	}
-	if (!ip)
+	if (!period || !strlen(period) || atoi(period) < 0)
 	{
-		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect ip\r\n\x1B[0m");
+		printf("\x1B[31m[evr][] Unable to configure poller: Missing or incorrect period\r\n\x1B[0m");
 		return -1;
 	}
-	if (!port || !strlen(port) || !atoi(port) || atoi(port) > USHRT_MAX)
+
+	device->poll	=	atoi(period);
+
+	return 0;
+}
+
+static void pollFunc (const iocshArgBuf *args)
+{
+    configurePoll(args[0].sval, args[1].sval);
+}
+
+static 	const 	iocshArg		loadMapArg0 	= 	{ "name",		iocshArgString };
+static 	const 	iocshArg		loadMapArg1 	= 	{ "file",		iocshArgString };
+static 	const 	iocshArg*		loadMapArgs[] = 
+{
+    &loadMapArg0,
+    &loadMapArg1,
+};
+static	const	iocshFuncDef	loadMapDef	=	{ "evrLoadMap", 2, loadMapArgs };
+static 	long	loadMap(char *name, char *file)
+{
+	int32_t		status;
+	uint32_t	line		=	0;
+	long		event;
+	unsigned long	map;
+	char		buffer[128];
+	char		*token;
+	char		*end;
+	FILE		*stream;
+	uint16_t	table[NUMBER_OF_EVENTS];
+	device_t	*device;
+
+	device	=	evr_open(name);
+	if (!device)
 	{
-		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect port\r\n\x1B[0m");
+		printf("\x1B[31m[evr][] Unable to load map: Device not found\r\n\x1B[0m");
 		return -1;
 	}
-	if (!frequency || !strlen(frequency) || !atoi(frequency))
+	if (!file || !(stream = fopen(file, "r")))
 	{
-		printf("\x1B[31m[evr][] Unable to configure device: Missing or incorrect name\r\n\x1B[0m");
+		printf("\x1B[31m[evr][] Unable to load map: Could not open file\r\n\x1B[0m");
 		return -1;
 	}
 
-	/*Try to resolve the hostname*/
-	if ((hostentry = gethostbyname(ip)) == NULL) 
+	/*Every line holds an event and its actions, events not listed are mapped to no action*/
+	memset(table, 0, sizeof(table));
+	while (fgets(buffer, sizeof(buffer), stream))
 	{
-		printf("\x1B[31mUnable to configure device: Could not resolve hostname\r\n\x1B[0m");
-		return -1;
+		line++;
+
+		/*Skip blank lines and comments*/
+		token	=	strtok(buffer, " \t\r\n");
+		if (!token || token[0] == '#')
+			continue;
+
+		event	=	strtol(token, &end, 0);
+		if (*end || event < 0 || event >= NUMBER_OF_EVENTS)
+		{
+			printf("\x1B[31m[evr][] Unable to load map: Invalid event on line %u\r\n\x1B[0m", line);
+			fclose(stream);
+			return -1;
+		}
+		token	=	strtok(NULL, " \t\r\n");
+		if (!token)
+		{
+			printf("\x1B[31m[evr][] Unable to load map: Missing actions on line %u\r\n\x1B[0m", line);
+			fclose(stream);
+			return -1;
+		}
+		map		=	strtoul(token, &end, 0);
+		if (*end || map > USHRT_MAX)
+		{
+			printf("\x1B[31m[evr][] Unable to load map: Invalid actions on line %u\r\n\x1B[0m", line);
+			fclose(stream);
+			return -1;
+		}
+		table[event]	=	map;
 	}
-	addr_list = (struct in_addr **) hostentry->h_addr_list;
+	fclose(stream);
 
-	if (addr_list[0] != NULL)
-		devices[deviceCount].ip = inet_addr(inet_ntoa(*addr_list[0]));
-	else
-		devices[deviceCount].ip	= inet_addr(ip);
+	/*Keep the table, the device is loaded again whenever it is brought up, see start()*/
+	pthread_mutex_lock(&device->mutex);
+	memcpy(device->table, table, sizeof(table));
+	device->loaded	=	true;
+	pthread_mutex_unlock(&device->mutex);
 
-	strcpy(devices[deviceCount].name, 	name);
-	devices[deviceCount].port		=	htons(atoi(port));
-	devices[deviceCount].frequency	=	atoi(frequency);
+	/*Before iocInit the device cannot be reached yet, its first bring-up loads the table*/
+	if (!initialized)
+		return 0;
 
-	deviceCount++;
+	status	=	evr_setMapTable(device, table);
+	if (status < 0)
+	{
+		printf("\x1B[31m[evr][] Unable to load map: Could not write mapping RAM, it is loaded when %s is brought up again\r\n\x1B[0m", name);
+		return -1;
+	}
 
 	return 0;
 }
 
-static void configureFunc (const iocshArgBuf *args)
+static void loadMapFunc (const iocshArgBuf *args)
 {
-    configure(args[0].sval, args[1].sval, args[2].sval, args[3].sval);
+    loadMap(args[0].sval, args[1].sval);
 }
 
 static void evrRegister(void)
 {
 	iocshRegister(&configureDef, configureFunc);
+	iocshRegister(&cacheDef, cacheFunc);
+	iocshRegister(&refreshDef, refreshFunc);
+	iocshRegister(&verifyDef, verifyFunc);
+	iocshRegister(&loadMapDef, loadMapFunc);
+	iocshRegister(&pollDef, pollFunc);
+	iocshRegister(&fifoDef, fifoFunc);
+	iocshRegister(&dataDef, dataFunc);
+	iocshRegister(&timeDef, timeFunc);
+	iocshRegister(&logDef, logFunc);
+	iocshRegister(&tapDef, tapFunc);
+	iocshRegister(&dumpDef, dumpFunc);
+	iocshRegister(&resolverDef, resolverFunc);
 }
 
 /*
@@ -29,90 +29,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-/**
- * @brief	VME-MRF-230/RF Register addresses
- */
-typedef enum
-{
-	REGISTER_CONTROL		=	0x00,
-	REGISTER_MAP_ADDRESS	=	0x02,
-	REGISTER_MAP_DATA		=	0x04,
-	REGISTER_PULSE_ENABLE	=	0x06,
-	REGISTER_LEVEL_ENABLE	=	0x08,
-	REGISTER_TRIGGER_ENABLE	=	0x0a,
-	REGISTER_PDP_ENABLE		=	0x18,
-	REGISTER_PULSE_SELECT	=	0x1a,
-	REGISTER_DBUS_ENABLE	=	0x24,
-	REGISTER_PULSE_PRESCALAR=	0x28,
-	REGISTER_FIRMWARE		=	0x2e,
-	REGISTER_FP_TTL7		=	0x3e,
-	REGISTER_FP_TTL0		=	0x40,
-	REGISTER_FP_TTL1		=	0x42,
-	REGISTER_FP_TTL2		=	0x44,
-	REGISTER_FP_TTL3		=	0x46,
-	REGISTER_FP_TTL4		=	0x48,
-	REGISTER_FP_TTL5		=	0x4a,
-	REGISTER_FP_TTL6		=	0x4c,
-	REGISTER_USEC_DIVIDER	=	0x4e,
-	REGISTER_EXTERNAL_EVENT	=	0x50,
-	REGISTER_CLOCK_CONTROL	=	0x52,
-	REGISTER_PULSE_POLARITY	=	0x68,
-	REGISTER_PULSE_DELAY	=	0x6c,
-	REGISTER_PULSE_WIDTH	=	0x70,
-	REGISTER_PRESCALAR_0	=	0x74,
-	REGISTER_PRESCALAR_1	=	0x76,
-	REGISTER_PRESCALAR_2	=	0x78,
-	REGISTER_FRAC_DIVIDER	=	0x80,
-	REGISTER_FP_UNIV0		=	0x90,
-	REGISTER_FP_UNIV1		=	0x92,
-	REGISTER_FP_UNIV2		=	0x94,
-	REGISTER_FP_UNIV3		=	0x96,
-	REGISTER_FP_UNIVGPIO	=	0x98,
-	REGISTER_CML4_ENABLE	=	0xb2,
-	REGISTER_CML4_HP		=	0xb4,
-	REGISTER_CML4_LP		=	0xb6,
-	REGISTER_CML5_ENABLE	=	0xd2,
-	REGISTER_CML5_HP		=	0xd4,
-	REGISTER_CML5_LP		=	0xd6,
-	REGISTER_CML6_ENABLE	=	0xf2,
-	REGISTER_CML6_HP		=	0xf4,
-	REGISTER_CML6_LP		=	0xf6,
-} evrregister_t;
-
-/*Register bit definitions*/
-#define CONTROL_EVR_ENABLE	0x8000
-#define CONTROL_MAP_ENABLE	0x0200
-#define CONTROL_FLUSH		0x0080
-#define CONTROL_RXVIO		0x0001
-#define PULSE_ENABLE_ALL	0x03FF
-#define PULSE_SELECT_OFFSET	16
-#define FP_MUX_PDP0			0
-#define FP_MUX_PDP1			1
-#define FP_MUX_PDP2			2
-#define FP_MUX_PDP3			3
-#define FP_MUX_OTP0			11	
-#define FP_MUX_OTP1			12	
-#define FP_MUX_OTP2			13	
-#define FP_MUX_OTP3			14	
-#define FP_MUX_OTP4			15	
-#define FP_MUX_OTP5			16	
-#define FP_MUX_OTP6			17	
-#define FP_MUX_OTP7			18	
-#define FP_MUX_OTP8			19	
-#define FP_MUX_PRE0			40	
-#define FP_MUX_PRE1			41
-#define FP_MUX_PRE2			42	
-#define CML_FREQUENCY_MODE	0x0010
-#define CML_ENABLE			0x0001
-
-/*EVR UDP packet field defitions*/
-#define ACCESS_READ		(1)
-#define ACCESS_WRITE	(2)
+/*EPICS headers*/
+#include <dbScan.h>
+#include <epicsTime.h>
+
+/*Application headers*/
+#include "protocol.h"
 
 /*Device name maximum length*/
 #define NAME_LENGTH				30
-/*EVR register base address*/
-#define REGISTER_BASE_ADDRESS	0x7a000000
 
 /*Number of outputs per device*/
 #define NUMBER_OF_PDP			4
@@ -123,9 +48,125 @@ typedef enum
 #define NUMBER_OF_UNIV			4
 #define NUMBER_OF_SOURCES		64
 
+/*Number of bins of the retransmission timeout histogram*/
+#define NUMBER_OF_BINS			24
+
+/*Size of a cache line, data written by different threads is kept on different lines*/
+#define CACHE_LINE				64
+
 /*Max event frequency*/
 #define MAX_EVENT_FREQUENCY		125
 
+/**
+ * @brief	An event received through the event FIFO
+ */
+typedef struct
+{
+	uint64_t	sequence;	/*Sequence number, the first event received by the device is 1*/
+	uint32_t	stamp;		/*Timestamp counter latched when the event was received*/
+	uint8_t		code;		/*Event code*/
+} evrevent_t;
+
+/**
+ * @brief	A consumer of the events of a device (see evr_subscribe and evr_receive)
+ */
+typedef struct
+{
+	void*		device;		/*Device the events are received from*/
+	uint64_t	cursor;		/*Number of events the consumer went past*/
+	uint64_t	overflows;	/*Number of events overwritten before they were received*/
+} __attribute__((aligned(CACHE_LINE))) evrsubscriber_t;
+
+/*Maximum size of a data buffer in bytes*/
+#define DATA_SIZE				2048
+
+/**
+ * @brief	A buffer received through distributed data transmission
+ *
+ * Buffers are shared by reference, see evr_acquireData and evr_releaseData, and never copied once received.
+ */
+typedef struct
+{
+	uint8_t		data[DATA_SIZE];	/*Received bytes*/
+	uint32_t	size;				/*Number of received bytes*/
+	uint64_t	sequence;			/*Number of buffers received by the device, this one included*/
+	uint32_t	references;			/*Number of holders of the buffer, the device holds its latest buffer*/
+	void*		device;				/*Device the buffer belongs to*/
+} __attribute__((aligned(CACHE_LINE))) evrbuffer_t;
+
+/**
+ * @brief	A register transaction kept by the flight recorder of a device (see evr_getTransactions)
+ *
+ * Binary dumps written by evrDumpTransactions are arrays of this structure, in host byte order, oldest first.
+ */
+typedef struct
+{
+	uint64_t	sequence;	/*Transaction number, the first transaction of the device is 1*/
+	int64_t		time;		/*Time in ns since the POSIX epoch at which the transaction completed*/
+	uint32_t	latency;	/*Time in us from the first transmission to the completion*/
+	uint16_t	reg;		/*Register address*/
+	uint16_t	data;		/*Data written, or data read back*/
+	uint8_t		access;		/*ACCESS_READ or ACCESS_WRITE*/
+	uint8_t		retries;	/*Number of retransmissions, saturated at 255*/
+	int8_t		status;		/*0 on success, -1 if the request was never answered*/
+	uint8_t		reserved[5];
+} evrtransaction_t;
+
+/**
+ * @brief	Statistics of the calls to one public function of a device (see evr_getApiStats)
+ *
+ * A call is timed from the moment it asks for the device until it leaves it, deferred write verification included.
+ */
+typedef struct
+{
+	uint64_t	calls;		/*Number of calls*/
+	uint64_t	failures;	/*Number of calls during which a transfer, read-back or deferred verification failed*/
+	uint64_t	retries;	/*Number of retransmissions of the requests of the calls*/
+	uint64_t	wait;		/*Total time in ns spent waiting for the device*/
+	uint64_t	wire;		/*Total time in ns spent transferring requests*/
+	uint64_t	total;		/*Total time in ns spent in the calls*/
+	uint64_t	tail;		/*99th percentile of the call latency in ns, rounded up to its histogram bin*/
+	uint32_t	histogram[NUMBER_OF_BINS];	/*Number of calls per latency, bin n counts latencies of 2^n to 2^(n+1) us*/
+} evrstats_t;
+
+/**
+ * @brief	A single register operation of a batched access (see evr_readRegs and evr_writeRegs)
+ */
+typedef struct
+{
+	evrregister_t	reg;		/*Register address*/
+	uint16_t		data;		/*Data to be written, or data read back*/
+	int32_t			status;		/*Filled in on completion: 0 on success, -1 on failure*/
+} evrop_t;
+
+/**
+ * @brief	Reason of the last failure of the calling thread (see evr_getError)
+ */
+typedef enum
+{
+	EVR_ERROR_NONE,		/*No link failure: invalid arguments, or data refused by the driver*/
+	EVR_ERROR_OFFLINE,	/*The device is offline, requests were not sent*/
+	EVR_ERROR_TIMEOUT,	/*A request was never answered*/
+	EVR_ERROR_MISMATCH,	/*A written register did not read back the written data*/
+} evrerror_t;
+
+/*Number of messages a logging site prints per LOG_INTERVAL seconds, the others are counted and reported with the next printed one*/
+#define LOG_BURST				5
+#define LOG_INTERVAL			10
+
+/**
+ * @brief	Rate limit of a logging site, see evr_log
+ */
+typedef struct
+{
+	uint64_t	window;		/*Interval the count belongs to*/
+	uint32_t	count;		/*Number of messages of the interval*/
+	uint32_t	suppressed;	/*Number of messages suppressed since the last printed one*/
+} evrlimit_t;
+
+/*Logs a plain text message, ending with a newline, through errlog, each call site limited to LOG_BURST messages per LOG_INTERVAL seconds*/
+#define evr_log(...)	do { static evrlimit_t limit; evr_logLimited(&limit, __VA_ARGS__); } while (0)
+
 /*
  * Low level functions
  */
@@ -136,6 +177,8 @@ long	evr_setClock			(void* device, uint16_t frequency);
 long	evr_getClock			(void* device, uint16_t *frequency);
 long	evr_setMap				(void* device, uint8_t event, uint16_t map);
 long	evr_getMap				(void* device, uint8_t event, uint16_t *map);
+long	evr_setMapTable			(void* device, uint16_t *table);
+long	evr_getMapTable			(void* device, uint16_t *table);
 long	evr_enable				(void* device, bool enable);
 long	evr_isEnabled			(void* device);
 long	evr_enablePulser		(void* device, uint8_t pulser, bool enable);
@@ -165,5 +208,38 @@ long	evr_setCmlPrescaler		(void* device, uint8_t cml, uint32_t prescaler);
 long	evr_getCmlPrescaler		(void* device, uint8_t cml, uint32_t *prescaler);
 long	evr_resetRxViolation	(void* device);
 long	evr_isRxViolation		(void* device);
+long	evr_readRegs			(void* device, evrop_t *ops, uint32_t count);
+long	evr_writeRegs			(void* device, evrop_t *ops, uint32_t count);
+long	evr_refresh				(void* device);
+long	evr_getIoScan			(void* device, evrregister_t reg, IOSCANPVT *scan);
+long	evr_submit				(void* device, void (*function)(void*), void *arg);
+long	evr_complete			(void* device, void (*function)(void*), void *arg);
+long	evr_verify				(void* device);
+long	evr_getQueueDepth		(void* device, uint32_t *depth);
+long	evr_getQueueLatency		(void* device, double *latency);
+long	evr_getRtt				(void* device, double *rtt);
+long	evr_getTimeout			(void* device, double *timeout);
+long	evr_getRetransmits		(void* device, uint32_t *retransmits);
+long	evr_getTimeoutHistogram	(void* device, uint32_t *histogram);
+long	evr_getDiscardedReplies	(void* device, uint32_t *discarded);
+long	evr_getBitScan			(void* device, evrregister_t reg, uint8_t bit, IOSCANPVT *scan);
+long	evr_releaseIoScan		(void* device, evrregister_t reg, IOSCANPVT *scan);
+long	evr_releaseBitScan		(void* device, evrregister_t reg, uint8_t bit, IOSCANPVT *scan);
+long	evr_getDbus				(void* device, uint8_t *data);
+long	evr_isOnline			(void* device);
+long	evr_getEventScan		(void* device, uint8_t code, IOSCANPVT *scan);
+long	evr_getEventCount		(void* device, uint8_t code, uint32_t *count);
+long	evr_getEventStamp		(void* device, uint8_t code, uint32_t *stamp);
+long	evr_getTime				(void* device, epicsTimeStamp *time);
+long	evr_getEventTime		(void* device, uint8_t code, epicsTimeStamp *time);
+long	evr_getApiStats			(void* device, const char *api, evrstats_t *stats);
+long	evr_getTransactions		(void* device, evrtransaction_t *transactions, uint32_t size, uint32_t *count);
+long	evr_getDataScan			(void* device, IOSCANPVT *scan);
+long	evr_acquireData			(void* device, evrbuffer_t **buffer);
+long	evr_releaseData			(evrbuffer_t *buffer);
+long	evr_subscribe			(void* device, evrsubscriber_t *subscriber);
+long	evr_receive				(evrsubscriber_t *subscriber, evrevent_t *events, uint32_t size, uint32_t *count);
+evrerror_t	evr_getError		(void);
+void	evr_logLimited			(evrlimit_t *limit, const char *format, ...) __attribute__((format(printf, 2, 3)));
 
 #endif /*__EVR_H__*/
@@ -0,0 +1,314 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3.0 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Abdallah Ismail <abdallah.ismail@sesame.org.jo>, 2015
+ */
+
+/*
+ * @file 	evrbench.c
+ * @author	Abdallah Ismail (abdallah.ismail@sesame.org.jo)
+ * @date 	2026-10-15
+ * @brief	Benchmarks the register transport of the driver against a device or evrsim
+ *
+ * The driver is built into the benchmark, so that its private transport functions can be driven directly.
+ * Each workload is run for a fixed time at every requested concurrency, with that many threads per device,
+ * and a CSV line is printed per run:
+ * 	workload,devices,threads,operations,failures,seconds,ops_per_s,p50_us,p99_us,p999_us,max_us,retransmits_per_op
+ * Latencies include the wait for the device mutex.
+ * Each device needs its own simulator, since the devices write the same registers: evrsim -p 2000 & evrsim -p 2001 & ...
+ *
+ * Workloads:
+ * 	read		:	readreg of a status register, answered by the device
+ * 	write		:	writereg of a status register
+ * 	writecheck	:	writecheck of a status register, write and read-back
+ * 	select		:	evr_setPulserDelay over all pulsers, a select write followed by data writes and read-backs
+ *
+ * Usage: evrbench [-a address] [-p port] [-n devices] [-c concurrencies] [-s seconds] [-w workloads]
+ * 	-a	:	Device address, 127.0.0.1 by default
+ * 	-p	:	Port of the first device, 2000 by default
+ * 	-n	:	Number of devices, all at the same address and on consecutive ports, 1 by default
+ * 	-c	:	Comma separated threads per device, 1,2,4 by default
+ * 	-s	:	Duration of each run in seconds, 2 by default
+ * 	-w	:	Comma separated workloads, all by default
+ */
+
+/*The driver, its private functions included*/
+#include "evr.c"
+
+/*
+ * Macros
+ */
+#define MAXIMUM_THREADS		64		/*Maximum number of threads per run*/
+#define MAXIMUM_SAMPLES		(1 << 20)	/*Maximum number of latencies kept per thread*/
+#define NUMBER_OF_WORKLOADS	4		/*Number of workloads*/
+
+/** @brief workload_t is the operation a benchmark run repeats*/
+typedef enum
+{
+	WORKLOAD_READ,
+	WORKLOAD_WRITE,
+	WORKLOAD_WRITECHECK,
+	WORKLOAD_SELECT,
+} workload_t;
+
+/** @brief bencher_t is the state of a benchmark thread*/
+typedef struct
+{
+	device_t		*device;		/*Device the thread works on*/
+	workload_t		workload;		/*Operation repeated by the thread*/
+	uint32_t		index;			/*Index of the thread on its device*/
+	uint64_t		operations;		/*Number of operations done*/
+	uint64_t		failures;		/*Number of operations that failed*/
+	uint32_t		*samples;		/*Latency in ns of the first MAXIMUM_SAMPLES operations*/
+} bencher_t;
+
+static	const	char	*names[NUMBER_OF_WORKLOADS]	=	{"read", "write", "writecheck", "select"};
+static	volatile	bool	running;				/*Cleared when a run is over*/
+
+/*Repeats an operation until the run is over*/
+static	void*	bench		(void *arg);
+/*Orders latencies*/
+static	int		compare		(const void *left, const void *right);
+/*Runs a workload at a concurrency and prints its results*/
+static	long	run			(workload_t workload, uint32_t threads, uint32_t seconds);
+
+int
+main(int argc, char *argv[])
+{
+	int32_t		option;
+	uint32_t	i;
+	uint32_t	j;
+	uint32_t	count		=	1;
+	uint32_t	seconds		=	2;
+	char		*address	=	"127.0.0.1";
+	uint32_t	port		=	2000;
+	char		concurrency[256]	=	"1,2,4";
+	char		workloads[256]		=	"read,write,writecheck,select";
+	char		name[NAME_LENGTH];
+	char		service[16];
+	char		*token;
+	char		*save;
+
+	while ((option = getopt(argc, argv, "a:p:n:c:s:w:")) != -1)
+	{
+		switch (option)
+		{
+			case 'a':	address	=	optarg;			break;
+			case 'p':	port	=	atoi(optarg);	break;
+			case 'n':	count	=	atoi(optarg);	break;
+			case 'c':	snprintf(concurrency, sizeof(concurrency), "%s", optarg);	break;
+			case 's':	seconds	=	atoi(optarg);	break;
+			case 'w':	snprintf(workloads, sizeof(workloads), "%s", optarg);		break;
+			default:
+				printf("Usage: %s [-a address] [-p port] [-n devices] [-c concurrencies] [-s seconds] [-w workloads]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		snprintf(name, sizeof(name), "bench%u", i);
+		snprintf(service, sizeof(service), "%u", port + i);
+		if (configure(name, address, service, "125") < 0)
+			return 1;
+	}
+	if (init() < 0)
+	{
+		printf("\x1B[31m[evrbench][main] Unable to initialize devices\n\x1B[0m");
+		return 1;
+	}
+	for (i = 0; i < deviceCount; i++)
+	{
+		if (!evr_isOnline(devices[i]))
+		{
+			printf("\x1B[31m[evrbench][main] %s is offline\n\x1B[0m", devices[i]->name);
+			return 1;
+		}
+	}
+
+	printf("workload,devices,threads,operations,failures,seconds,ops_per_s,p50_us,p99_us,p999_us,max_us,retransmits_per_op\n");
+	for (token = strtok_r(workloads, ",", &save); token; token = strtok_r(NULL, ",", &save))
+	{
+		for (j = 0; j < NUMBER_OF_WORKLOADS && strcmp(token, names[j]); j++);
+		if (j == NUMBER_OF_WORKLOADS)
+		{
+			printf("\x1B[31m[evrbench][main] Unknown workload %s\n\x1B[0m", token);
+			return 1;
+		}
+		for (i = 0; concurrency[i]; i += strcspn(concurrency + i, ",") + (concurrency[i + strcspn(concurrency + i, ",")] != 0))
+			run((workload_t)j, atoi(concurrency + i), seconds);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Repeats an operation until the run is over
+ *
+ * @param	arg	:	Pointer to the state of the thread
+ * @return	NULL
+ */
+static void*
+bench(void *arg)
+{
+	int32_t			status;
+	uint16_t		data;
+	struct timespec	start;
+	struct timespec	end;
+	bencher_t		*bencher	=	(bencher_t*)arg;
+	device_t		*device		=	bencher->device;
+
+	while (running)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		switch (bencher->workload)
+		{
+			case WORKLOAD_READ:
+				pthread_mutex_lock(&device->mutex);
+				status	=	readreg(device, REGISTER_PULSE_ENABLE, &data);
+				release(device);
+				break;
+			case WORKLOAD_WRITE:
+				pthread_mutex_lock(&device->mutex);
+				status	=	writereg(device, REGISTER_LEVEL_ENABLE, bencher->operations & 0x3ff);
+				release(device);
+				break;
+			case WORKLOAD_WRITECHECK:
+				pthread_mutex_lock(&device->mutex);
+				status	=	writecheck(device, REGISTER_LEVEL_ENABLE, bencher->operations & 0x3ff);
+				status	|=	release(device);
+				break;
+			default:
+				status	=	evr_setPulserDelay(device, (bencher->operations + bencher->index)%NUMBER_OF_PULSERS, bencher->operations%100);
+				break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		if (bencher->operations < MAXIMUM_SAMPLES)
+			bencher->samples[bencher->operations]	=	elapsed(&start, &end);
+		bencher->operations++;
+		if (status < 0)
+			bencher->failures++;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Orders latencies
+ */
+static int
+compare(const void *left, const void *right)
+{
+	uint32_t	a	=	*(const uint32_t*)left;
+	uint32_t	b	=	*(const uint32_t*)right;
+
+	return (a > b) - (a < b);
+}
+
+/**
+ * @brief	Runs a workload with a number of threads per device, and prints a CSV line of its results
+ *
+ * @param	workload	:	The workload
+ * @param	threads		:	Number of threads per device
+ * @param	seconds		:	Duration of the run
+ * @return	0 on success, -1 on failure
+ */
+static long
+run(workload_t workload, uint32_t threads, uint32_t seconds)
+{
+	uint32_t		i;
+	uint32_t		count;
+	uint64_t		operations	=	0;
+	uint64_t		failures	=	0;
+	uint64_t		retransmits	=	0;
+	uint64_t		samples		=	0;
+	uint32_t		*latencies;
+	double			duration;
+	struct timespec	start;
+	struct timespec	end;
+	pthread_t		handles[MAXIMUM_THREADS];
+	bencher_t		benchers[MAXIMUM_THREADS];
+
+	count	=	threads*deviceCount;
+	if (!threads || count > MAXIMUM_THREADS)
+	{
+		printf("\x1B[31m[evrbench][run] Number of threads must be between 1 and %u\n\x1B[0m", MAXIMUM_THREADS);
+		return -1;
+	}
+
+	for (i = 0; i < deviceCount; i++)
+	{
+		pthread_mutex_lock(&devices[i]->lock);
+		retransmits	-=	devices[i]->retransmits;
+		pthread_mutex_unlock(&devices[i]->lock);
+	}
+
+	running	=	true;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+	{
+		memset(&benchers[i], 0, sizeof(benchers[i]));
+		benchers[i].device		=	devices[i%deviceCount];
+		benchers[i].workload	=	workload;
+		benchers[i].index		=	i/deviceCount;
+		benchers[i].samples		=	malloc(MAXIMUM_SAMPLES*sizeof(uint32_t));
+		if (!benchers[i].samples || pthread_create(&handles[i], NULL, bench, &benchers[i]))
+		{
+			printf("\x1B[31m[evrbench][run] Unable to start thread\n\x1B[0m");
+			exit(1);
+		}
+	}
+	sleep(seconds);
+	running	=	false;
+	for (i = 0; i < count; i++)
+		pthread_join(handles[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	duration	=	elapsed(&start, &end)/1e9;
+
+	for (i = 0; i < deviceCount; i++)
+	{
+		pthread_mutex_lock(&devices[i]->lock);
+		retransmits	+=	devices[i]->retransmits;
+		pthread_mutex_unlock(&devices[i]->lock);
+	}
+
+	/*Gather the latencies of all threads*/
+	for (i = 0; i < count; i++)
+	{
+		operations	+=	benchers[i].operations;
+		failures	+=	benchers[i].failures;
+		samples		+=	(benchers[i].operations < MAXIMUM_SAMPLES) ? benchers[i].operations : MAXIMUM_SAMPLES;
+	}
+	latencies	=	malloc((samples ? samples : 1)*sizeof(uint32_t));
+	if (!latencies)
+		exit(1);
+	for (samples = 0, i = 0; i < count; i++)
+	{
+		memcpy(latencies + samples, benchers[i].samples, ((benchers[i].operations < MAXIMUM_SAMPLES) ? benchers[i].operations : MAXIMUM_SAMPLES)*sizeof(uint32_t));
+		samples	+=	(benchers[i].operations < MAXIMUM_SAMPLES) ? benchers[i].operations : MAXIMUM_SAMPLES;
+		free(benchers[i].samples);
+	}
+	qsort(latencies, samples, sizeof(uint32_t), compare);
+
+	printf("%s,%u,%u,%llu,%llu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.4f\n", names[workload], deviceCount, threads,
+		(unsigned long long)operations, (unsigned long long)failures, duration, operations/duration,
+		samples ? latencies[samples/2]/1e3 : 0, samples ? latencies[samples*99/100]/1e3 : 0,
+		samples ? latencies[samples*999/1000]/1e3 : 0, samples ? latencies[samples - 1]/1e3 : 0,
+		operations ? (double)retransmits/operations : 0);
+	fflush(stdout);
+	free(latencies);
+
+	return 0;
+}
@@ -0,0 +1,493 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3.0 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Abdallah Ismail <abdallah.ismail@sesame.org.jo>, 2015
+ */
+
+/*
+ * @file 	evrsim.c
+ * @author	Abdallah Ismail (abdallah.ismail@sesame.org.jo)
+ * @date 	2026-10-15
+ * @brief	Simulates the UDP register interface of the VME-EVR-230 on the local host
+ *
+ * The simulator answers the register protocol spoken by evr.c, so that the driver can be run and load-tested
+ * without a device: point evrConfigure at the host and port of the simulator.
+ * It models the register file, including the registers behind REGISTER_PULSE_SELECT and REGISTER_MAP_ADDRESS,
+ * the self-clearing control bits, the timestamp counter and the event FIFO.
+ * Replies can be delayed, jittered, lost, reordered and duplicated.
+ *
+ * Usage: evrsim [-p port] [-l latency] [-j jitter] [-L loss] [-r reorder] [-d duplicate] [-e rate] [-s seed]
+ * 	-p	:	UDP port, 2000 by default
+ * 	-l	:	Reply latency in us
+ * 	-j	:	Reply jitter in us, replies are delayed by latency +/- jitter
+ * 	-L	:	Percentage of requests lost, and of replies lost
+ * 	-r	:	Percentage of replies held back by a further latency + jitter, so that later replies overtake them
+ * 	-d	:	Percentage of replies sent twice
+ * 	-e	:	Rate in Hz of the events pushed to the event FIFO, 0 by default
+ * 	-s	:	Seed of the random number generator
+ */
+
+/*Standard includes*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/*ppoll*/
+#endif
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/*Application includes*/
+#include "protocol.h"
+
+/*
+ * Macros
+ */
+#define DEFAULT_PORT		2000	/*Port the simulator listens on*/
+#define SIMULATED_SPACE		0x1000	/*Size of the simulated register space in bytes*/
+#define FIFO_DEPTH			512		/*Depth of the event FIFO, the oldest events are lost when it overflows*/
+#define PENDING_SIZE		4096	/*Maximum number of replies waiting for their time to be sent*/
+#define FIRMWARE_VERSION	0x1105	/*Value of REGISTER_FIRMWARE*/
+
+/** @brief pending_t is a reply waiting for its time to be sent*/
+typedef struct
+{
+	uint64_t			due;		/*Time in us at which the reply is sent*/
+	message_t			message;	/*The reply*/
+	struct sockaddr_in	peer;		/*Where the reply is sent*/
+} pending_t;
+
+/** @brief event_t is an entry of the event FIFO*/
+typedef struct
+{
+	uint8_t		code;		/*Event code*/
+	uint32_t	stamp;		/*Timestamp counter when the event was received*/
+} event_t;
+
+/*
+ * Private members
+ */
+static	uint32_t	latency		=	0;			/*Reply latency in us*/
+static	uint32_t	jitter		=	0;			/*Reply jitter in us*/
+static	double		loss		=	0;			/*Probability of losing a request, and of losing a reply*/
+static	double		reorder		=	0;			/*Probability of holding a reply back*/
+static	double		duplicate	=	0;			/*Probability of sending a reply twice*/
+static	double		rate		=	0;			/*Rate in Hz of the events pushed to the event FIFO*/
+static	uint64_t	origin;						/*Time in us at which the simulator started*/
+static	volatile sig_atomic_t	stop	=	0;	/*Set by signals to stop the simulator*/
+
+static	uint16_t	registers[SIMULATED_SPACE/2];					/*Directly addressed registers*/
+static	uint16_t	pulsers[NUMBER_OF_SELECTS][PULSE_REGISTERS];	/*Registers behind REGISTER_PULSE_SELECT*/
+static	uint16_t	map[NUMBER_OF_EVENTS];							/*Event mapping RAM, behind REGISTER_MAP_ADDRESS*/
+
+static	event_t		fifo[FIFO_DEPTH];			/*Event FIFO*/
+static	uint32_t	fifoHead	=	0;			/*Index of the oldest event*/
+static	uint32_t	fifoDepth	=	0;			/*Number of events in the FIFO*/
+static	uint64_t	generated	=	0;			/*Number of events pushed to the FIFO*/
+
+static	pending_t	pending[PENDING_SIZE];		/*Replies waiting to be sent, a binary heap ordered by due time*/
+static	uint32_t	pendingCount	=	0;		/*Number of replies waiting to be sent*/
+
+static	uint64_t	requests	=	0;			/*Number of requests received*/
+static	uint64_t	replies		=	0;			/*Number of replies sent*/
+static	uint64_t	lostRequests	=	0;		/*Number of requests dropped*/
+static	uint64_t	lostReplies	=	0;			/*Number of replies dropped*/
+static	uint64_t	reordered	=	0;			/*Number of replies held back*/
+static	uint64_t	duplicated	=	0;			/*Number of replies sent twice*/
+static	uint64_t	malformed	=	0;			/*Number of requests dropped because of their size, access or address*/
+
+/*
+ * Private function prototypes
+ */
+/*Returns the monotonic time in us*/
+static	uint64_t	now			(void);
+/*Returns true with the given probability*/
+static	bool		chance		(double probability);
+/*Pushes the events due by now to the event FIFO*/
+static	void		generate	(void);
+/*Returns the register an indirect access resolves to*/
+static	uint16_t*	locate		(uint32_t offset);
+/*Executes a request on the register file*/
+static	long		execute		(message_t *message);
+/*Queues a reply to be sent at a given time*/
+static	void		schedule	(message_t *message, struct sockaddr_in *peer, uint64_t due);
+/*Sends the replies due by now*/
+static	void		flush		(int32_t socket);
+/*Stops the simulator*/
+static	void		interrupt	(int signal);
+
+/*
+ * Function definitions
+ */
+
+int
+main(int argc, char *argv[])
+{
+	int32_t				status;
+	int32_t				option;
+	struct timespec		timeout;
+	struct timespec		*wait;
+	int32_t				sock;
+	uint32_t			port	=	DEFAULT_PORT;
+	uint32_t			seed	=	(uint32_t)time(NULL);
+	uint64_t			delay;
+	double				spread;
+	socklen_t			length;
+	message_t			message;
+	struct sockaddr_in	address;
+	struct sockaddr_in	peer;
+	struct pollfd		descriptor;
+
+	while ((option = getopt(argc, argv, "p:l:j:L:r:d:e:s:")) != -1)
+	{
+		switch (option)
+		{
+			case 'p':	port		=	atoi(optarg);			break;
+			case 'l':	latency		=	atoi(optarg);			break;
+			case 'j':	jitter		=	atoi(optarg);			break;
+			case 'L':	loss		=	atof(optarg)/100.0;		break;
+			case 'r':	reorder		=	atof(optarg)/100.0;		break;
+			case 'd':	duplicate	=	atof(optarg)/100.0;		break;
+			case 'e':	rate		=	atof(optarg);			break;
+			case 's':	seed		=	atoi(optarg);			break;
+			default:
+				printf("Usage: %s [-p port] [-l latency] [-j jitter] [-L loss] [-r reorder] [-d duplicate] [-e rate] [-s seed]\n", argv[0]);
+				return 1;
+		}
+	}
+	srand48(seed);
+
+	sock	=	socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0)
+	{
+		printf("\x1B[31m[evrsim][main] Unable to create socket\n\x1B[0m");
+		return 1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sin_family		=	AF_INET;
+	address.sin_addr.s_addr	=	htonl(INADDR_ANY);
+	address.sin_port		=	htons(port);
+	status	=	bind(sock, (struct sockaddr*)&address, sizeof(address));
+	if (status < 0)
+	{
+		printf("\x1B[31m[evrsim][main] Unable to bind to port %u\n\x1B[0m", port);
+		return 1;
+	}
+
+	signal(SIGINT, interrupt);
+	signal(SIGTERM, interrupt);
+
+	registers[REGISTER_FIRMWARE/2]	=	FIRMWARE_VERSION;
+	origin	=	now();
+	printf("[evrsim][main] Listening on port %u, latency %uus, jitter %uus, loss %.1f%%, reorder %.1f%%, duplicate %.1f%%, events %.0fHz, seed %u\n",
+		port, latency, jitter, loss*100, reorder*100, duplicate*100, rate, seed);
+
+	descriptor.fd		=	sock;
+	descriptor.events	=	POLLIN;
+	while (!stop)
+	{
+		/*Wait for a request or for the next reply to be due*/
+		wait	=	NULL;
+		if (pendingCount || rate > 0)
+		{
+			delay	=	100000;
+			if (pendingCount)
+				delay	=	(pending[0].due > now()) ? pending[0].due - now() : 0;
+			timeout.tv_sec	=	delay/1000000;
+			timeout.tv_nsec	=	(delay%1000000)*1000;
+			wait			=	&timeout;
+		}
+		ppoll(&descriptor, 1, wait, NULL);
+
+		generate();
+
+		while (true)
+		{
+			length	=	sizeof(peer);
+			status	=	recvfrom(sock, &message, sizeof(message), MSG_DONTWAIT, (struct sockaddr*)&peer, &length);
+			if (status < 0)
+				break;
+			requests++;
+			if (chance(loss))
+			{
+				lostRequests++;
+				continue;
+			}
+			if (status != sizeof(message) || execute(&message) < 0)
+			{
+				malformed++;
+				continue;
+			}
+			if (chance(loss))
+			{
+				lostReplies++;
+				continue;
+			}
+
+			/*Delay the reply, holding some back so that later replies overtake them*/
+			spread	=	latency + jitter*(2*drand48() - 1);
+			delay	=	(spread > 0) ? spread : 0;
+			if (chance(reorder))
+			{
+				delay	+=	latency + jitter + 1;
+				reordered++;
+			}
+			schedule(&message, &peer, now() + delay);
+			if (chance(duplicate))
+			{
+				schedule(&message, &peer, now() + delay + latency + 1);
+				duplicated++;
+			}
+		}
+
+		flush(sock);
+	}
+
+	printf("[evrsim][main] Requests %llu, replies %llu, lost requests %llu, lost replies %llu, reordered %llu, duplicated %llu, malformed %llu, events %llu\n",
+		(unsigned long long)requests, (unsigned long long)replies, (unsigned long long)lostRequests, (unsigned long long)lostReplies,
+		(unsigned long long)reordered, (unsigned long long)duplicated, (unsigned long long)malformed, (unsigned long long)generated);
+	close(sock);
+
+	return 0;
+}
+
+/**
+ * @brief	Returns the monotonic time in us
+ */
+static uint64_t
+now(void)
+{
+	struct timespec	time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec*1000000ULL + time.tv_nsec/1000;
+}
+
+/**
+ * @brief	Returns true with the given probability
+ */
+static bool
+chance(double probability)
+{
+	return (probability > 0 && drand48() < probability);
+}
+
+/**
+ * @brief	Pushes the events due by now to the event FIFO
+ *
+ * Events are numbered from 1, and their codes cycle through 1 to 10. The FIFO keeps the most recent FIFO_DEPTH events.
+ * The timestamp counter runs at 1MHz from the start of the simulator.
+ */
+static void
+generate(void)
+{
+	uint64_t	due;
+	event_t		*event;
+
+	if (rate <= 0)
+		return;
+
+	due	=	(now() - origin)*rate/1000000;
+	while (generated < due)
+	{
+		generated++;
+		if (fifoDepth == FIFO_DEPTH)
+		{
+			fifoHead	=	(fifoHead + 1)%FIFO_DEPTH;
+			fifoDepth--;
+		}
+		event			=	&fifo[(fifoHead + fifoDepth)%FIFO_DEPTH];
+		event->code		=	generated%10 + 1;
+		event->stamp	=	(uint32_t)(generated*1000000/rate);
+		fifoDepth++;
+	}
+}
+
+/**
+ * @brief	Returns the register an access resolves to
+ *
+ * Pulser registers and the mapping RAM data register are resolved through the value of their select register.
+ *
+ * @param	offset	:	Register offset from REGISTER_BASE_ADDRESS
+ * @return	Pointer to the register, NULL if the selection is out of range
+ */
+static uint16_t*
+locate(uint32_t offset)
+{
+	uint16_t	pulse	=	registers[REGISTER_PULSE_SELECT/2];
+	uint16_t	address	=	registers[REGISTER_MAP_ADDRESS/2];
+
+	switch (offset)
+	{
+		case REGISTER_PULSE_PRESCALAR:	return pulse < NUMBER_OF_SELECTS ? &pulsers[pulse][0] : NULL;
+		case REGISTER_PULSE_DELAY:		return pulse < NUMBER_OF_SELECTS ? &pulsers[pulse][1] : NULL;
+		case REGISTER_PULSE_DELAY+2:	return pulse < NUMBER_OF_SELECTS ? &pulsers[pulse][2] : NULL;
+		case REGISTER_PULSE_WIDTH:		return pulse < NUMBER_OF_SELECTS ? &pulsers[pulse][3] : NULL;
+		case REGISTER_PULSE_WIDTH+2:	return pulse < NUMBER_OF_SELECTS ? &pulsers[pulse][4] : NULL;
+		case REGISTER_MAP_DATA:			return address < NUMBER_OF_EVENTS ? &map[address] : NULL;
+		default:						return &registers[offset/2];
+	}
+}
+
+/**
+ * @brief	Executes a request on the register file, and turns it into its reply
+ *
+ * @param	*message	:	The request, turned into the reply
+ * @return	0 on success, -1 if the request is malformed
+ */
+static long
+execute(message_t *message)
+{
+	uint32_t	i;
+	uint32_t	offset;
+	uint32_t	stamp;
+	uint16_t	data;
+	uint16_t	*reg;
+
+	offset	=	ntohl(message->address) - REGISTER_BASE_ADDRESS;
+	if (offset >= SIMULATED_SPACE || offset%2 || (message->access != ACCESS_READ && message->access != ACCESS_WRITE))
+		return -1;
+	data	=	ntohs(message->data);
+	reg		=	locate(offset);
+	stamp	=	(uint32_t)(now() - origin);
+
+	if (message->access == ACCESS_WRITE)
+	{
+		if (offset == REGISTER_CONTROL)
+		{
+			/*The flush bit clears the mapping RAM, and the violation flag is cleared by writing it*/
+			if (data & CONTROL_FLUSH)
+			{
+				for (i = 0; i < NUMBER_OF_EVENTS; i++)
+					map[i]	=	0;
+			}
+			data	&=	~(CONTROL_FLUSH | CONTROL_RXVIO);
+		}
+		if (reg)
+			*reg	=	data;
+	}
+	else
+	{
+		switch (offset)
+		{
+			case REGISTER_TIME_HI:
+				data	=	stamp >> 16;
+				break;
+			case REGISTER_TIME_LO:
+				data	=	stamp & 0xffff;
+				break;
+			case REGISTER_FIFO_EVENT:
+				/*A pop latches the timestamp of the event, an empty FIFO reads as event code 0*/
+				data	=	0;
+				if (fifoDepth)
+				{
+					data	=	fifo[fifoHead].code;
+					registers[REGISTER_FIFO_TIME_HI/2]	=	fifo[fifoHead].stamp >> 16;
+					registers[REGISTER_FIFO_TIME_LO/2]	=	fifo[fifoHead].stamp & 0xffff;
+					fifoHead	=	(fifoHead + 1)%FIFO_DEPTH;
+					fifoDepth--;
+				}
+				break;
+			default:
+				data	=	reg ? *reg : 0;
+				break;
+		}
+	}
+
+	message->status	=	0;
+	message->data	=	htons(data);
+
+	return 0;
+}
+
+/**
+ * @brief	Queues a reply to be sent at a given time
+ *
+ * Replies beyond PENDING_SIZE are dropped, as a device would drop requests it has no room for.
+ */
+static void
+schedule(message_t *message, struct sockaddr_in *peer, uint64_t due)
+{
+	uint32_t	i;
+	pending_t	entry;
+
+	if (pendingCount == PENDING_SIZE)
+	{
+		lostReplies++;
+		return;
+	}
+
+	/*Sift the new entry up the heap*/
+	i	=	pendingCount++;
+	pending[i].due		=	due;
+	pending[i].message	=	*message;
+	pending[i].peer		=	*peer;
+	while (i && pending[(i - 1)/2].due > pending[i].due)
+	{
+		entry				=	pending[i];
+		pending[i]			=	pending[(i - 1)/2];
+		pending[(i - 1)/2]	=	entry;
+		i					=	(i - 1)/2;
+	}
+}
+
+/**
+ * @brief	Sends the replies due by now
+ */
+static void
+flush(int32_t socket)
+{
+	uint32_t	i;
+	uint32_t	child;
+	uint64_t	time	=	now();
+	pending_t	entry;
+
+	while (pendingCount && pending[0].due <= time)
+	{
+		sendto(socket, &pending[0].message, sizeof(message_t), 0, (struct sockaddr*)&pending[0].peer, sizeof(pending[0].peer));
+		replies++;
+
+		/*Sift the last entry down from the top of the heap*/
+		pending[0]	=	pending[--pendingCount];
+		i			=	0;
+		while ((child = 2*i + 1) < pendingCount)
+		{
+			if (child + 1 < pendingCount && pending[child + 1].due < pending[child].due)
+				child++;
+			if (pending[i].due <= pending[child].due)
+				break;
+			entry			=	pending[i];
+			pending[i]		=	pending[child];
+			pending[child]	=	entry;
+			i				=	child;
+		}
+	}
+}
+
+/**
+ * @brief	Stops the simulator
+ */
+static void
+interrupt(int signal)
+{
+	(void)signal;
+	stop	=	1;
+}
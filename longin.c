@@ -28,7 +28,6 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <pthread.h>
 
 /*EPICS includes*/
 #include <epicsExport.h>
@@ -36,39 +35,55 @@
 #include <errlog.h>
 #include <dbAccess.h>
 #include <recSup.h>
+#include <recGbl.h>
+#include <alarm.h>
 #include <longinRecord.h>
 
 /*Application includes*/
 #include "parse.h"
 #include "evr.h"
 
-/*Macros*/
-#define NUMBER_OF_IO	100
-
-/*Local variables*/
-static	io_t		io[NUMBER_OF_IO];
-static	uint32_t	ioCount;
-
 /*Function prototypes*/
-static	long	init		(int after);
 static	long	initRecord	(longinRecord *record);
 static 	long	ioRecord	(longinRecord *record);
-static	void*	thread		(void* arg);
+static	void	process		(void* arg);
+static	long	getPrescaler	(io_t *private, void *record);
+static	long	getPdpPrescaler	(io_t *private, void *record);
+static	long	getCmlPrescaler	(io_t *private, void *record);
+static	long	getMap	(io_t *private, void *record);
+static	long	getClock	(io_t *private, void *record);
+static	long	getFirmwareVersion	(io_t *private, void *record);
+static	long	getQueueDepth	(io_t *private, void *record);
+static	long	getRetransmits	(io_t *private, void *record);
+static	long	getDiscardedReplies	(io_t *private, void *record);
+static	long	getEventCount	(io_t *private, void *record);
+static	long	getEventStamp	(io_t *private, void *record);
+static	long	getApiCalls	(io_t *private, void *record);
+static	long	getApiFailures	(io_t *private, void *record);
+static	long	getApiRetries	(io_t *private, void *record);
+static	long	ioIntInfo	(int command, longinRecord *record, IOSCANPVT *scan);
 
-/*Function definitions*/
-
-/** 
- * @brief 	Initializes record count
- *
- * @return	0 on success, -1 on failure
- */
-static long
-init(int after)
+/*Commands understood by longin records*/
+static	const	command_t	commands[]	=
 {
-	if (!after)
-		ioCount = 0;
-	return 0;
-}
+	{"getPrescaler",	getPrescaler},
+	{"getPdpPrescaler",	getPdpPrescaler},
+	{"getCmlPrescaler",	getCmlPrescaler},
+	{"getMap",	getMap},
+	{"getClock",	getClock},
+	{"getFirmwareVersion",	getFirmwareVersion},
+	{"getQueueDepth",	getQueueDepth},
+	{"getRetransmits",	getRetransmits},
+	{"getDiscardedReplies",	getDiscardedReplies},
+	{"getEventCount",	getEventCount},
+	{"getEventStamp",	getEventStamp},
+	{"getApiCalls",	getApiCalls},
+	{"getApiFailures",	getApiFailures},
+	{"getApiRetries",	getApiRetries},
+	{NULL,	NULL}
+};
+
+/*Function definitions*/
 
 /** 
  * @brief 	Initializes the record
@@ -86,34 +101,43 @@ static long
 initRecord(longinRecord *record)
 {
 	int32_t	status;
+	io_t	*private;
 
-	if (ioCount >= NUMBER_OF_IO)
+	if (record->inp.type != INST_IO) 
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Too many records\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
 		return -1;
 	}
-	if (record->inp.type != INST_IO) 
+
+	private	=	evr_allocate();
+	if (!private)
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Could not allocate private structure\r\n", record->name);
 		return -1;
 	}
 
-	status			=	evr_parse(&io[ioCount], record->inp.value.instio.string);
+	status			=	evr_parse(private, record->inp.value.instio.string);
 	if (status < 0)
 	{
 		printf("[evr][initRecord] Unable to initialize %s: Could not parse parameters\r\n", record->name);
 		return -1;
 	}
 
-	io[ioCount].device	=	evr_open(io[ioCount].name);	
-	if (io[ioCount].device == NULL)
+	status			=	evr_resolve(private, commands);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Unknown command\r\n", record->name);
+		return -1;
+	}
+
+	private->device	=	evr_open(private->name);	
+	if (private->device == NULL)
 	{
 		printf("[evr][initRecord] Unable to initalize %s: Could not open device\r\n", record->name);
 		return -1;
 	}
 
-	record->dpvt	=	&io[ioCount];
-	ioCount++;
+	record->dpvt	=	private;
 
 	return 0;
 }
@@ -134,7 +158,6 @@ ioRecord(longinRecord *record)
 {
 	int32_t		status	=	0;
 	io_t*		private	=	(io_t*)record->dpvt;
-	pthread_t	handle;
 
 	if (!record)
 	{
@@ -156,13 +179,14 @@ ioRecord(longinRecord *record)
 	 * Start IO
 	 */
 
-	/*If this is the first pass then start IO thread, set PACT, and return*/
+	/*If this is the first pass then queue IO to the device's worker pool, set PACT, and return*/
 	if(!record->pact)
 	{
-		status	=	pthread_create(&handle, NULL, thread, (void*)record);	
-		if (status)
+		status	=	evr_submit(private->device, process, (void*)record);
+		if (status < 0)
 		{
-			printf("[evr][ioRecord] Unable to perform IO on %s: Unable to create thread\r\n", record->name);
+			evr_log("[evr][ioRecord] Unable to perform IO on %s: Unable to queue request\n", record->name);
+			recGblSetSevr(record, SCAN_ALARM, INVALID_ALARM);
 			return -1;
 		}
 		record->pact = true;
@@ -174,7 +198,8 @@ ioRecord(longinRecord *record)
 	 */
 	if (private->status	< 0)
 	{
-		printf("[evr][ioRecord] Unable to perform IO on %s\r\n", record->name);
+		evr_log("[evr][ioRecord] Unable to perform IO on %s\n", record->name);
+		recGblSetSevr(record, evr_getAlarm(private, READ_ALARM), INVALID_ALARM);
 		record->pact=	false;
 		return -1;
 	}
@@ -186,53 +211,214 @@ ioRecord(longinRecord *record)
 /** 
  * @brief 	Performs asynchronousIO on the record
  *
- * This function attemps the following:
- * 	Detaches the thread
+ * This function is executed by a worker of the device's pool and attemps the following:
  * 	Performs the requested IO
  *	Processes the record to finalize IO
  *
- * @param	arg	:	Pointer to thread arguments
- * @return	0 on success, -1 on failure
+ * @param	arg	:	Pointer to the record
  */
-void*
-thread(void* arg)
+static void
+process(void* arg)
 {
 	int			status	=	0;
 	longinRecord*	record	=	(longinRecord*)arg;
 	io_t*		private	=	(io_t*)record->dpvt;
 
-	/*Detach thread*/
-	pthread_detach(pthread_self());
-
-	if (strcmp(private->command, "getPrescaler") == 0)
-		status	=	evr_getPrescaler(private->device, private->parameter, (uint16_t*)&record->val);
-	else if (strcmp(private->command, "getPdpPrescaler") == 0)
-		status	=	evr_getPdpPrescaler(private->device, private->parameter, (uint16_t*)&record->val);
-	else if (strcmp(private->command, "getCmlPrescaler") == 0)
-		status	=	evr_getCmlPrescaler(private->device, private->parameter, (uint32_t*)&record->val);
-	else if (strcmp(private->command, "getMap") == 0)
-		status	=	evr_getMap(private->device, private->parameter, (uint16_t*)&record->val);
-	else if (strcmp(private->command, "getClock") == 0)
-		status	=	evr_getClock(private->device, (uint16_t*)&record->val);
-	else if (strcmp(private->command, "getFirmwareVersion") == 0)
-		status	=	evr_getFirmwareVersion(private->device, (uint16_t*)&record->val);
-	else
-	{
-		printf("[evr][thread] Unable to io %s: Do not know how to process \"%s\" requested by %s\r\n", record->name, private->command, record->name);
-		private->status	=	-1;
-	}
+	private->status	=	0;
+
+	status	=	private->handler(private, record);
 	if (status < 0)
 	{
-		printf("[evr][thread] Unable to io %s\r\n", record->name);
+		evr_log("[evr][process] Unable to io %s\n", record->name);
 		private->status	=	-1;
+		private->error	=	evr_getError();
 	}
 
 	/*Process record*/
 	dbScanLock((struct dbCommon*)record);
 	(record->rset->process)(record);
 	dbScanUnlock((struct dbCommon*)record);
+}
+
+/** 
+ * @brief 	Command handlers, resolved from the command table by initRecord
+ *
+ * @param	private	:	Private structure of the record
+ * @param	record	:	Pointer to the record
+ * @return	0 on success, -1 on failure
+ */
+static long
+getPrescaler(io_t *private, void *record)
+{
+	return evr_getPrescaler(private->device, private->parameter, (uint16_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getPdpPrescaler(io_t *private, void *record)
+{
+	return evr_getPdpPrescaler(private->device, private->parameter, (uint16_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getCmlPrescaler(io_t *private, void *record)
+{
+	return evr_getCmlPrescaler(private->device, private->parameter, (uint32_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getMap(io_t *private, void *record)
+{
+	return evr_getMap(private->device, private->parameter, (uint16_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getClock(io_t *private, void *record)
+{
+	return evr_getClock(private->device, (uint16_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getFirmwareVersion(io_t *private, void *record)
+{
+	return evr_getFirmwareVersion(private->device, (uint16_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getQueueDepth(io_t *private, void *record)
+{
+	return evr_getQueueDepth(private->device, (uint32_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getRetransmits(io_t *private, void *record)
+{
+	return evr_getRetransmits(private->device, (uint32_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getDiscardedReplies(io_t *private, void *record)
+{
+	return evr_getDiscardedReplies(private->device, (uint32_t*)&((longinRecord*)record)->val);
+}
+
+static long
+getEventCount(io_t *private, void *record)
+{
+	longinRecord*	longin	=	(longinRecord*)record;
+
+	if (private->parameter >= NUMBER_OF_EVENTS)
+		return -1;
+	/*Records with TSE set to -2 take the time the event was received at*/
+	if (longin->tse == epicsTimeEventDeviceTime)
+		evr_getEventTime(private->device, private->parameter, &longin->time);
+	return evr_getEventCount(private->device, private->parameter, (uint32_t*)&longin->val);
+}
 
-	return NULL;
+static long
+getEventStamp(io_t *private, void *record)
+{
+	longinRecord*	longin	=	(longinRecord*)record;
+
+	if (private->parameter >= NUMBER_OF_EVENTS)
+		return -1;
+	if (longin->tse == epicsTimeEventDeviceTime)
+		evr_getEventTime(private->device, private->parameter, &longin->time);
+	return evr_getEventStamp(private->device, private->parameter, (uint32_t*)&longin->val);
+}
+
+static long
+getApiCalls(io_t *private, void *record)
+{
+	evrstats_t	stats;
+
+	if (evr_getApiStats(private->device, private->api, &stats) < 0)
+		return -1;
+	((longinRecord*)record)->val	=	stats.calls;
+	return 0;
+}
+
+static long
+getApiFailures(io_t *private, void *record)
+{
+	evrstats_t	stats;
+
+	if (evr_getApiStats(private->device, private->api, &stats) < 0)
+		return -1;
+	((longinRecord*)record)->val	=	stats.failures;
+	return 0;
+}
+
+static long
+getApiRetries(io_t *private, void *record)
+{
+	evrstats_t	stats;
+
+	if (evr_getApiStats(private->device, private->api, &stats) < 0)
+		return -1;
+	((longinRecord*)record)->val	=	stats.retries;
+	return 0;
+}
+
+/** 
+ * @brief 	Returns the I/O Intr scan list of the record
+ *
+ * Only commands that read a single status register can be scanned on I/O Intr,
+ * the record is then scanned by the device's status poller whenever the register changes.
+ * A deleted record releases the register, which is no longer polled once no record uses it.
+ * Event records are scanned whenever the event is received.
+ *
+ * @param	command	:	0 if the record is added to the scan list, 1 if it is deleted
+ * @param	record	:	Pointer to the record
+ * @param	scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+static long
+ioIntInfo(int command, longinRecord *record, IOSCANPVT *scan)
+{
+	long			status;
+	evrregister_t	reg;
+	io_t*			private	=	(io_t*)record->dpvt;
+
+	if (!private)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: Null private structure pointer\r\n", record->name);
+		return -1;
+	}
+
+	/*Event records are scanned by the event FIFO drain*/
+	if (private->handler == getEventCount || private->handler == getEventStamp)
+	{
+		if (private->parameter >= NUMBER_OF_EVENTS || evr_getEventScan(private->device, private->parameter, scan) < 0)
+		{
+			printf("[evr][ioIntInfo] Unable to scan %s\r\n", record->name);
+			return -1;
+		}
+		return 0;
+	}
+
+	if (private->handler == getPrescaler && private->parameter < NUMBER_OF_PRESCALERS)
+		reg	=	REGISTER_PRESCALAR_0 + private->parameter*2;
+	else if (private->handler == getClock)
+		reg	=	REGISTER_USEC_DIVIDER;
+	else if (private->handler == getFirmwareVersion)
+		reg	=	REGISTER_FIRMWARE;
+	else
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: \"%s\" cannot be scanned on I/O Intr\r\n", record->name, private->command);
+		return -1;
+	}
+
+	if (command)
+		status	=	evr_releaseIoScan(private->device, reg, scan);
+	else
+		status	=	evr_getIoScan(private->device, reg, scan);
+	if (status < 0)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s\r\n", record->name);
+		return -1;
+	}
+
+	return 0;
 }
 
 struct devsup {
@@ -246,9 +432,9 @@ struct devsup {
 {
     5,
     NULL,
-    init,
-    initRecord,
     NULL,
+    initRecord,
+    ioIntInfo,
     ioRecord
 };
 epicsExportAddress(dset, longinevr);
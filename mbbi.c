@@ -28,7 +28,6 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <pthread.h>
 
 /*EPICS includes*/
 #include <epicsExport.h>
@@ -36,39 +35,31 @@
 #include <errlog.h>
 #include <dbAccess.h>
 #include <recSup.h>
+#include <recGbl.h>
+#include <alarm.h>
 #include <mbbiRecord.h>
 
 /*Application includes*/
 #include "parse.h"
 #include "evr.h"
 
-/*Macros*/
-#define NUMBER_OF_IO	100
-
-/*Local variables*/
-static	io_t		io[NUMBER_OF_IO];
-static	uint32_t	ioCount;
-
 /*Function prototypes*/
-static	long	init		(int after);
 static	long	initRecord	(mbbiRecord *record);
 static 	long	ioRecord	(mbbiRecord *record);
-static	void*	thread		(void* arg);
+static	void	process		(void* arg);
+static	long	getTTLSource	(io_t *private, void *record);
+static	long	getUNIVSource	(io_t *private, void *record);
+static	long	ioIntInfo	(int command, mbbiRecord *record, IOSCANPVT *scan);
 
-/*Function definitions*/
-
-/** 
- * @brief 	Initializes record count
- *
- * @return	0 on success, -1 on failure
- */
-static long
-init(int after)
+/*Commands understood by mbbi records*/
+static	const	command_t	commands[]	=
 {
-	if (!after)
-		ioCount = 0;
-	return 0;
-}
+	{"getTTLSource",	getTTLSource},
+	{"getUNIVSource",	getUNIVSource},
+	{NULL,	NULL}
+};
+
+/*Function definitions*/
 
 /** 
  * @brief 	Initializes the record
@@ -86,34 +77,43 @@ static long
 initRecord(mbbiRecord *record)
 {
 	int32_t	status;
+	io_t	*private;
 
-	if (ioCount >= NUMBER_OF_IO)
+	if (record->inp.type != INST_IO) 
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Too many records\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
 		return -1;
 	}
-	if (record->inp.type != INST_IO) 
+
+	private	=	evr_allocate();
+	if (!private)
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Could not allocate private structure\r\n", record->name);
 		return -1;
 	}
 
-	status			=	evr_parse(&io[ioCount], record->inp.value.instio.string);
+	status			=	evr_parse(private, record->inp.value.instio.string);
 	if (status < 0)
 	{
 		printf("[evr][initRecord] Unable to initialize %s: Could not parse parameters\r\n", record->name);
 		return -1;
 	}
 
-	io[ioCount].device	=	evr_open(io[ioCount].name);	
-	if (io[ioCount].device == NULL)
+	status			=	evr_resolve(private, commands);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Unknown command\r\n", record->name);
+		return -1;
+	}
+
+	private->device	=	evr_open(private->name);	
+	if (private->device == NULL)
 	{
 		printf("[evr][initRecord] Unable to initalize %s: Could not open device\r\n", record->name);
 		return -1;
 	}
 
-	record->dpvt	=	&io[ioCount];
-	ioCount++;
+	record->dpvt	=	private;
 
 	return 0;
 }
@@ -134,7 +134,6 @@ ioRecord(mbbiRecord *record)
 {
 	int32_t		status	=	0;
 	io_t*		private	=	(io_t*)record->dpvt;
-	pthread_t	handle;
 
 	if (!record)
 	{
@@ -156,13 +155,14 @@ ioRecord(mbbiRecord *record)
 	 * Start IO
 	 */
 
-	/*If this is the first pass then start IO thread, set PACT, and return*/
+	/*If this is the first pass then queue IO to the device's worker pool, set PACT, and return*/
 	if(!record->pact)
 	{
-		status	=	pthread_create(&handle, NULL, thread, (void*)record);	
-		if (status)
+		status	=	evr_submit(private->device, process, (void*)record);
+		if (status < 0)
 		{
-			printf("[evr][ioRecord] Unable to perform IO on %s: Unable to create thread\r\n", record->name);
+			evr_log("[evr][ioRecord] Unable to perform IO on %s: Unable to queue request\n", record->name);
+			recGblSetSevr(record, SCAN_ALARM, INVALID_ALARM);
 			return -1;
 		}
 		record->pact = true;
@@ -174,7 +174,8 @@ ioRecord(mbbiRecord *record)
 	 */
 	if (private->status	< 0)
 	{
-		printf("[evr][ioRecord] Unable to perform IO on %s\r\n", record->name);
+		evr_log("[evr][ioRecord] Unable to perform IO on %s\n", record->name);
+		recGblSetSevr(record, evr_getAlarm(private, READ_ALARM), INVALID_ALARM);
 		record->pact=	false;
 		return -1;
 	}
@@ -186,47 +187,110 @@ ioRecord(mbbiRecord *record)
 /** 
  * @brief 	Performs asynchronousIO on the record
  *
- * This function attemps the following:
- * 	Detaches the thread
+ * This function is executed by a worker of the device's pool and attemps the following:
  * 	Performs the requested IO
  *	Processes the record to finalize IO
  *
- * @param	arg	:	Pointer to thread arguments
- * @return	0 on success, -1 on failure
+ * @param	arg	:	Pointer to the record
  */
-void*
-thread(void* arg)
+static void
+process(void* arg)
 {
 	int			status	=	0;
 	mbbiRecord*	record	=	(mbbiRecord*)arg;
 	io_t*		private	=	(io_t*)record->dpvt;
-	uint8_t		source;	
 
-	/*Detach thread*/
-	pthread_detach(pthread_self());
+	private->status	=	0;
 
-	if (strcmp(private->command, "getTTLSource") == 0)
-		status	=	evr_getTTLSource(private->device, private->parameter, &source);
-	else if (strcmp(private->command, "getUNIVSource") == 0)
-		status	=	evr_getUNIVSource(private->device, private->parameter, &source);
-	else
-	{
-		printf("[evr][thread] Unable to io %s: Do not know how to process \"%s\" requested by %s\r\n", record->name, private->command, record->name);
-		private->status	=	-1;
-	}
+	status	=	private->handler(private, record);
 	if (status < 0)
 	{
-		printf("[evr][thread] Unable to io %s\r\n", record->name);
+		evr_log("[evr][process] Unable to io %s\n", record->name);
 		private->status	=	-1;
+		private->error	=	evr_getError();
 	}
-	record->rval	=	source;
 
 	/*Process record*/
 	dbScanLock((struct dbCommon*)record);
 	(record->rset->process)(record);
 	dbScanUnlock((struct dbCommon*)record);
+}
+
+/** 
+ * @brief 	Command handlers, resolved from the command table by initRecord
+ *
+ * @param	private	:	Private structure of the record
+ * @param	record	:	Pointer to the record
+ * @return	0 on success, -1 on failure
+ */
+static long
+getTTLSource(io_t *private, void *record)
+{
+	uint8_t	source;
 
-	return NULL;
+	if (evr_getTTLSource(private->device, private->parameter, &source) < 0)
+		return -1;
+	((mbbiRecord*)record)->rval	=	source;
+	return 0;
+}
+
+static long
+getUNIVSource(io_t *private, void *record)
+{
+	uint8_t	source;
+
+	if (evr_getUNIVSource(private->device, private->parameter, &source) < 0)
+		return -1;
+	((mbbiRecord*)record)->rval	=	source;
+	return 0;
+}
+
+/** 
+ * @brief 	Returns the I/O Intr scan list of the record
+ *
+ * Only commands that read a single status register can be scanned on I/O Intr,
+ * the record is then scanned by the device's status poller whenever the register changes.
+ * A deleted record releases the register, which is no longer polled once no record uses it.
+ *
+ * @param	command	:	0 if the record is added to the scan list, 1 if it is deleted
+ * @param	record	:	Pointer to the record
+ * @param	scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+static long
+ioIntInfo(int command, mbbiRecord *record, IOSCANPVT *scan)
+{
+	long			status;
+	evrregister_t	reg;
+	io_t*			private	=	(io_t*)record->dpvt;
+
+	if (!private)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: Null private structure pointer\r\n", record->name);
+		return -1;
+	}
+
+	if (private->handler == getTTLSource && private->parameter < NUMBER_OF_TTL)
+		reg	=	REGISTER_FP_TTL0 + private->parameter*2;
+	else if (private->handler == getUNIVSource && private->parameter < NUMBER_OF_UNIV)
+		reg	=	REGISTER_FP_UNIV0 + private->parameter*2;
+	else
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: \"%s\" cannot be scanned on I/O Intr\r\n", record->name, private->command);
+		return -1;
+	}
+
+	if (command)
+		status	=	evr_releaseIoScan(private->device, reg, scan);
+	else
+		status	=	evr_getIoScan(private->device, reg, scan);
+	if (status < 0)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s\r\n", record->name);
+		return -1;
+	}
+
+	return 0;
 }
 
 struct devsup {
@@ -240,9 +304,9 @@ struct devsup {
 {
     5,
     NULL,
-    init,
-    initRecord,
     NULL,
+    initRecord,
+    ioIntInfo,
     ioRecord
 };
 epicsExportAddress(dset, mbbievr);
@@ -0,0 +1,297 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3.0 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTAmbbiLITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Abdallah Ismail <abdallah.ismail@sesame.org.jo>, 2015
+ */
+
+/*
+ * @file 	mbbiDirect.c
+ * @author	Abdallah Ismail (abdallah.ismail@sesame.org.jo)
+ * @date 	2026-10-15
+ * @brief	Implements epics device support layer for the PMC-EVR230 event receiver
+ */
+
+/*Standard includes*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*EPICS includes*/
+#include <epicsExport.h>
+#include <devSup.h>
+#include <errlog.h>
+#include <dbAccess.h>
+#include <recSup.h>
+#include <recGbl.h>
+#include <alarm.h>
+#include <mbbiDirectRecord.h>
+
+/*Application includes*/
+#include "parse.h"
+#include "evr.h"
+
+/*Function prototypes*/
+static	long	initRecord	(mbbiDirectRecord *record);
+static 	long	ioRecord	(mbbiDirectRecord *record);
+static	void	process		(void* arg);
+static	long	getDbus		(io_t *private, void *record);
+static	long	ioIntInfo	(int command, mbbiDirectRecord *record, IOSCANPVT *scan);
+
+/*Commands understood by mbbiDirect records*/
+static	const	command_t	commands[]	=
+{
+	{"getDbus",	getDbus},
+	{NULL,	NULL}
+};
+
+/*Function definitions*/
+
+/** 
+ * @brief 	Initializes the record
+ *
+ * This function is called by recordInit during IOC initialization.
+ * For each record of this type, this function attemps the following:
+ * 	Checks record parameters.
+ * 	Parses record parameters.
+ * 	Sets record's private structure.
+ *
+ * @param	record	:	Pointer to record being initialized.
+ * @return	0 on success, -1 on failure.
+ */
+static long 
+initRecord(mbbiDirectRecord *record)
+{
+	int32_t	status;
+	io_t	*private;
+
+	if (record->inp.type != INST_IO) 
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
+		return -1;
+	}
+
+	private	=	evr_allocate();
+	if (!private)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Could not allocate private structure\r\n", record->name);
+		return -1;
+	}
+
+	status			=	evr_parse(private, record->inp.value.instio.string);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Could not parse parameters\r\n", record->name);
+		return -1;
+	}
+
+	status			=	evr_resolve(private, commands);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Unknown command\r\n", record->name);
+		return -1;
+	}
+
+	private->device	=	evr_open(private->name);	
+	if (private->device == NULL)
+	{
+		printf("[evr][initRecord] Unable to initalize %s: Could not open device\r\n", record->name);
+		return -1;
+	}
+
+	record->dpvt	=	private;
+
+	return 0;
+}
+
+/** 
+ * @brief 	Performs IO on the record.
+ *
+ * This function is called by record support to perform IO on the record
+ * This function attemps the following:
+ * 	Checks record parameters.
+ * 	Executes record IO.
+ *
+ * @param	record	:	Pointer to record being initialized.
+ * @return	0 on success, -1 on failure.
+ */
+static long 
+ioRecord(mbbiDirectRecord *record)
+{
+	int32_t		status	=	0;
+	io_t*		private	=	(io_t*)record->dpvt;
+
+	if (!record)
+	{
+		printf("[evr][ioRecord] Unable to perform io on %s: Null record pointer\r\n", record->name);
+		return -1;
+	}
+    if (!private)
+    {
+        printf("[evr][ioRecord] Unable to perform io on %s: Null private structure pointer\r\n", record->name);
+        return -1;
+    }
+	if (!private->command || !strlen(private->command))
+	{
+		printf("[evr][ioRecord] Unable to perform io on %s: Command is null or empty\r\n", record->name);
+		return -1;
+	}
+
+	/*
+	 * Start IO
+	 */
+
+	/*If this is the first pass then queue IO to the device's worker pool, set PACT, and return*/
+	if(!record->pact)
+	{
+		status	=	evr_submit(private->device, process, (void*)record);
+		if (status < 0)
+		{
+			evr_log("[evr][ioRecord] Unable to perform IO on %s: Unable to queue request\n", record->name);
+			recGblSetSevr(record, SCAN_ALARM, INVALID_ALARM);
+			return -1;
+		}
+		record->pact = true;
+		return 0;
+	}
+
+	/*
+	 * This is the second pass, complete the request and return
+	 */
+	if (private->status	< 0)
+	{
+		evr_log("[evr][ioRecord] Unable to perform IO on %s\n", record->name);
+		recGblSetSevr(record, evr_getAlarm(private, READ_ALARM), INVALID_ALARM);
+		record->pact=	false;
+		return -1;
+	}
+	record->pact	=	false;
+
+	return 0;
+}
+
+/** 
+ * @brief 	Performs asynchronousIO on the record
+ *
+ * This function is executed by a worker of the device's pool and attemps the following:
+ * 	Performs the requested IO
+ *	Processes the record to finalize IO
+ *
+ * @param	arg	:	Pointer to the record
+ */
+static void
+process(void* arg)
+{
+	int			status	=	0;
+	mbbiDirectRecord*	record	=	(mbbiDirectRecord*)arg;
+	io_t*		private	=	(io_t*)record->dpvt;
+
+	private->status	=	0;
+
+	status	=	private->handler(private, record);
+	if (status < 0)
+	{
+		evr_log("[evr][process] Unable to io %s\n", record->name);
+		private->status	=	-1;
+		private->error	=	evr_getError();
+	}
+
+	/*Process record*/
+	dbScanLock((struct dbCommon*)record);
+	(record->rset->process)(record);
+	dbScanUnlock((struct dbCommon*)record);
+}
+
+/** 
+ * @brief 	Command handlers, resolved from the command table by initRecord
+ *
+ * @param	private	:	Private structure of the record
+ * @param	record	:	Pointer to the record
+ * @return	0 on success, -1 on failure
+ */
+static long
+getDbus(io_t *private, void *record)
+{
+	uint8_t	data;
+
+	if (evr_getDbus(private->device, &data) < 0)
+		return -1;
+	((mbbiDirectRecord*)record)->rval	=	data;
+	return 0;
+}
+
+/** 
+ * @brief 	Returns the I/O Intr scan list of the record
+ *
+ * Only commands that read a single status register can be scanned on I/O Intr,
+ * the record is then scanned by the device's status poller whenever the register changes.
+ * A deleted record releases the register, which is no longer polled once no record uses it.
+ *
+ * @param	command	:	0 if the record is added to the scan list, 1 if it is deleted
+ * @param	record	:	Pointer to the record
+ * @param	scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+static long
+ioIntInfo(int command, mbbiDirectRecord *record, IOSCANPVT *scan)
+{
+	long			status;
+	evrregister_t	reg;
+	io_t*			private	=	(io_t*)record->dpvt;
+
+	if (!private)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: Null private structure pointer\r\n", record->name);
+		return -1;
+	}
+
+	if (private->handler == getDbus)
+		reg	=	REGISTER_DBUS_DATA;
+	else
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: \"%s\" cannot be scanned on I/O Intr\r\n", record->name, private->command);
+		return -1;
+	}
+
+	if (command)
+		status	=	evr_releaseIoScan(private->device, reg, scan);
+	else
+		status	=	evr_getIoScan(private->device, reg, scan);
+	if (status < 0)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s\r\n", record->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct devsup {
+    long	  number;
+    DEVSUPFUN report;
+    DEVSUPFUN init;
+    DEVSUPFUN init_record;
+    DEVSUPFUN get_ioint_info;
+    DEVSUPFUN io;
+} mbbiDirectevr =
+{
+    5,
+    NULL,
+    NULL,
+    initRecord,
+    ioIntInfo,
+    ioRecord
+};
+epicsExportAddress(dset, mbbiDirectevr);
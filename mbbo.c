@@ -28,46 +28,37 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <pthread.h>
 
 /*EPICS includes*/
 #include <epicsExport.h>
 #include <devSup.h>
 #include <dbAccess.h>
 #include <recSup.h>
+#include <recGbl.h>
+#include <alarm.h>
 #include <mbboRecord.h>
 
 /*Application includes*/
 #include "parse.h"
 #include "evr.h"
 
-/*Macros*/
-#define NUMBER_OF_IO	100
-
-/*Local variables*/
-static	io_t		io[NUMBER_OF_IO];
-static	uint32_t	ioCount;
-
 /*Function prototypes*/
-static	long	init		(int after);
 static	long	initRecord	(mbboRecord *record);
 static 	long	ioRecord	(mbboRecord *record);
-static	void*	thread		(void* arg);
-
-/*Function definitions*/
+static	void	process		(void* arg);
+static	void	complete	(void* arg);
+static	long	setTTLSource	(io_t *private, void *record);
+static	long	setUNIVSource	(io_t *private, void *record);
 
-/** 
- * @brief 	Initializes record count
- *
- * @return	0 on success, -1 on failure
- */
-static long
-init(int after)
+/*Commands understood by mbbo records*/
+static	const	command_t	commands[]	=
 {
-	if (!after)
-		ioCount = 0;
-	return 0;
-}
+	{"setTTLSource",	setTTLSource},
+	{"setUNIVSource",	setUNIVSource},
+	{NULL,	NULL}
+};
+
+/*Function definitions*/
 
 /** 
  * @brief 	Initializes the record
@@ -85,34 +76,43 @@ static long
 initRecord(mbboRecord *record)
 {
 	int32_t	status;
+	io_t	*private;
 
-	if (ioCount >= NUMBER_OF_IO)
+	if (record->out.type != INST_IO) 
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Too many records\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
 		return -1;
 	}
-	if (record->out.type != INST_IO) 
+
+	private	=	evr_allocate();
+	if (!private)
 	{
-		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
+		printf("[evr][initRecord] Unable to initialize %s: Could not allocate private structure\r\n", record->name);
 		return -1;
 	}
 
-	status				=	evr_parse(&io[ioCount], record->out.value.instio.string);
+	status				=	evr_parse(private, record->out.value.instio.string);
 	if (status < 0)
 	{
 		printf("[evr][initRecord] Unable to initialize %s: Could not parse parameters\r\n", record->name);
 		return -1;
 	}
 
-	io[ioCount].device	=	evr_open(io[ioCount].name);	
-	if (io[ioCount].device == NULL)
+	status			=	evr_resolve(private, commands);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Unknown command\r\n", record->name);
+		return -1;
+	}
+
+	private->device	=	evr_open(private->name);	
+	if (private->device == NULL)
 	{
 		printf("[evr][initRecord] Unable to initalize %s: Could not open device\r\n", record->name);
 		return -1;
 	}
 
-	record->dpvt	=	&io[ioCount];
-	ioCount++;
+	record->dpvt	=	private;
 
 	return 0;
 }
@@ -125,7 +125,7 @@ initRecord(mbboRecord *record)
  * 	Checks record parameters.
  * 	Parses IO string
  * 	Sets record's private structure
- * 	Starts thread that performs asynchronous IO on the record
+ * 	Queues asynchronous IO on the record to the device's worker pool
  *
  * @param	record	:	Pointer to record being initializes
  * @return	0 on success, -1 on failure
@@ -135,7 +135,6 @@ ioRecord(mbboRecord *record)
 {
 	int32_t		status	=	0;
 	io_t*		private	=	(io_t*)record->dpvt;
-	pthread_t	handle;
 
 	if (!record)
 	{
@@ -157,13 +156,14 @@ ioRecord(mbboRecord *record)
 	 * Start IO
 	 */
 
-	/*If this is the first pass then start IO thread, set PACT, and return*/
+	/*If this is the first pass then queue IO to the device's worker pool, set PACT, and return*/
 	if(!record->pact)
 	{
-		status	=	pthread_create(&handle, NULL, thread, (void*)record);	
-		if (status)
+		status	=	evr_submit(private->device, process, (void*)record);
+		if (status < 0)
 		{
-			printf("[evr][ioRecord] Unable to perform IO on %s: Unable to create thread\r\n", record->name);
+			evr_log("[evr][ioRecord] Unable to perform IO on %s: Unable to queue request\n", record->name);
+			recGblSetSevr(record, SCAN_ALARM, INVALID_ALARM);
 			return -1;
 		}
 		record->pact = true;
@@ -175,7 +175,8 @@ ioRecord(mbboRecord *record)
 	 */
 	if (private->status	< 0)
 	{
-		printf("[evr][ioRecord] Unable to perform IO on %s\r\n", record->name);
+		evr_log("[evr][ioRecord] Unable to perform IO on %s\n", record->name);
+		recGblSetSevr(record, evr_getAlarm(private, WRITE_ALARM), INVALID_ALARM);
 		record->pact=	false;
 		return -1;
 	}
@@ -187,45 +188,79 @@ ioRecord(mbboRecord *record)
 /** 
  * @brief 	Performs asynchronousIO on the record
  *
- * This function attemps the following:
- * 	Detaches the thread
+ * This function is executed by a worker of the device's pool and attemps the following:
  * 	Performs the requested IO
  *	Processes the record to finalize IO
  *
- * @param	arg	:	Pointer to thread arguments
- * @return	0 on success, -1 on failure
+ * @param	arg	:	Pointer to the record
  */
-void*
-thread(void* arg)
+static void
+process(void* arg)
 {
 	int			status	=	0;
 	mbboRecord*	record	=	(mbboRecord*)arg;
 	io_t*		private	=	(io_t*)record->dpvt;
 
-	/*Detach thread*/
-	pthread_detach(pthread_self());
+	private->status	=	0;
 
-	if (strcmp(private->command, "setTTLSource") == 0)
-		status	=	evr_setTTLSource(private->device, private->parameter, record->rval);
-	else if (strcmp(private->command, "setUNIVSource") == 0)
-		status	=	evr_setUNIVSource(private->device, private->parameter, record->rval);
-	else
+	status	=	private->handler(private, record);
+	if (status < 0)
 	{
-		printf("[evr][thread] Unable to io %s: Do not know how to process \"%s\" requested by %s\r\n", record->name, private->command, record->name);
+		evr_log("[evr][process] Unable to io %s\n", record->name);
 		private->status	=	-1;
+		private->error	=	evr_getError();
 	}
-	if (status < 0)
+
+	/*With a verifier, the record completes once its writes are read back*/
+	if (evr_complete(private->device, complete, record) > 0)
+		return;
+	complete(record);
+}
+
+/** 
+ * @brief 	Completes asynchronous IO on the record
+ *
+ * This function is executed by the worker that performed the IO, or by a worker of the device's pool
+ * once the writes of the IO are read back, see evr_complete. A write that was not verified fails the IO.
+ *
+ * @param	arg	:	Pointer to the record
+ */
+static void
+complete(void* arg)
+{
+	mbboRecord*	record	=	(mbboRecord*)arg;
+	io_t*		private	=	(io_t*)record->dpvt;
+
+	if (private->status == 0 && evr_getError() != EVR_ERROR_NONE)
 	{
-		printf("[evr][thread] Unable to io %s\r\n", record->name);
+		evr_log("[evr][complete] Unable to verify writes of %s\n", record->name);
 		private->status	=	-1;
+		private->error	=	evr_getError();
 	}
 
 	/*Process record*/
 	dbScanLock((struct dbCommon*)record);
 	(record->rset->process)(record);
 	dbScanUnlock((struct dbCommon*)record);
+}
+
+/** 
+ * @brief 	Command handlers, resolved from the command table by initRecord
+ *
+ * @param	private	:	Private structure of the record
+ * @param	record	:	Pointer to the record
+ * @return	0 on success, -1 on failure
+ */
+static long
+setTTLSource(io_t *private, void *record)
+{
+	return evr_setTTLSource(private->device, private->parameter, ((mbboRecord*)record)->rval);
+}
 
-	return NULL;
+static long
+setUNIVSource(io_t *private, void *record)
+{
+	return evr_setUNIVSource(private->device, private->parameter, ((mbboRecord*)record)->rval);
 }
 
 struct devsup {
@@ -239,7 +274,7 @@ struct devsup {
 {
     5,
     NULL,
-    init,
+    NULL,
     initRecord,
     NULL,
     ioRecord
@@ -3,9 +3,15 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <alarm.h>
+
 #include "parse.h"
+#include "evr.h"
+
+/*Local variables*/
+static	io_t		*arena		=	NULL;		/*Chunk io structures are currently taken from*/
+static	uint32_t	arenaCount	=	ARENA_SIZE;	/*Number of io structures taken from the chunk*/
 
-/*Macros*/
 long
 evr_parse(io_t *io, char *parameters)
 {
@@ -75,6 +81,8 @@ evr_parse(io_t *io, char *parameters)
 		/*Process key-value pair*/
 		if (strcmp(key, "parameter") == 0)
 			io->parameter	=	strtol(value, NULL, 0);
+		else if (strcmp(key, "api") == 0)
+			strcpy(io->api, value);
 		else
 		{
 			printf("[evr][parse] Unable to parse: Key is not recognized.\n");
@@ -84,3 +92,86 @@ evr_parse(io_t *io, char *parameters)
 	return 0;
 }
 
+
+/**
+ * @brief	Resolves the command of a parsed record into its handler
+ *
+ * Called once by initRecord, so that processing the record does not look the command up again.
+ *
+ * @param	*io			:	The parsed record
+ * @param	*commands	:	Command table of the record type
+ * @return	0 on success, -1 if the record type does not know the command
+ */
+long
+evr_resolve(io_t *io, const command_t *commands)
+{
+	/*Check parameters*/
+	if (!io || !commands)
+	{
+		printf("[evr][resolve] Unable to resolve: Null parameters\n");
+		return -1;
+	}
+
+	for (; commands->name; commands++)
+	{
+		if (strcmp(io->command, commands->name) == 0)
+		{
+			io->handler	=	commands->handler;
+			return 0;
+		}
+	}
+
+	printf("[evr][resolve] Unable to resolve: Unknown command \"%s\"\n", io->command);
+	return -1;
+}
+
+/**
+ * @brief	Allocates the private structure of a record
+ *
+ * Structures are carved from chunks of ARENA_SIZE, so that thousands of records cost a few allocations.
+ * Records live as long as the IOC, structures are never freed.
+ * Called by initRecord, which iocInit runs from a single thread.
+ *
+ * @return	A zeroed io structure, NULL on failure
+ */
+io_t*
+evr_allocate(void)
+{
+	if (arenaCount >= ARENA_SIZE)
+	{
+		arena	=	calloc(ARENA_SIZE, sizeof(io_t));
+		if (!arena)
+		{
+			printf("[evr][allocate] Unable to allocate: Out of memory\n");
+			return NULL;
+		}
+		arenaCount	=	0;
+	}
+
+	return &arena[arenaCount++];
+}
+
+/**
+ * @brief	Returns the alarm status a failed IO raises on its record
+ *
+ * Link failures raise their own status, so that an offline or silent device is told apart from a refused value.
+ *
+ * @param	io		:	Private structure of the record
+ * @param	alarm	:	Status raised by other failures, READ_ALARM or WRITE_ALARM
+ * @return	The alarm status
+ */
+long
+evr_getAlarm(io_t *io, long alarm)
+{
+	switch (io->error)
+	{
+		case EVR_ERROR_OFFLINE:
+			return COMM_ALARM;
+		case EVR_ERROR_TIMEOUT:
+			return TIMEOUT_ALARM;
+		case EVR_ERROR_MISMATCH:
+			return WRITE_ALARM;
+		default:
+			return alarm;
+	}
+}
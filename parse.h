@@ -6,19 +6,38 @@
 /*Macros*/
 #define NAME_LENGTH			30
 #define TOKEN_LENGTH		30
+#define ARENA_SIZE			64		/*Number of io structures allocated at once*/
 
 typedef struct device_t	device_t;
+typedef struct io_t		io_t;
 
-typedef struct
+/*Performs a command on a record, returns a negative value on failure*/
+typedef long	(*handler_t)(io_t *io, void *record);
+
+struct io_t
 {
 	device_t*	device;
 	int32_t		status;
+	int32_t		error;		/*Reason of the last failed IO, see evrerror_t*/
 	char		name	[NAME_LENGTH];
 	char		command	[TOKEN_LENGTH];
 	uint32_t	parameter;
-} io_t;
+	char		api		[TOKEN_LENGTH];	/*Public function whose statistics the record reads, if any*/
+	handler_t	handler;
+	void*		context;	/*State the handler keeps between scans, if any*/
+};
+
+/*Entry of a record type's command table, the table ends with a NULL name*/
+typedef struct
+{
+	const char*	name;
+	handler_t	handler;
+} command_t;
 
 /*Function prototypes*/
 long	evr_parse	(io_t *io, char* parameters);
+long	evr_resolve	(io_t *io, const command_t *commands);
+io_t*	evr_allocate	(void);
+long	evr_getAlarm	(io_t *io, long alarm);
 
 #endif /*parse.h*/
@@ -0,0 +1,146 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3.0 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Abdallah Ismail <abdallah.ismail@sesame.org.jo>, 2015
+ */
+
+/**
+ * @file 	protocol.h
+ * @author	Abdallah Ismail (abdallah.ismail@sesame.org.jo)
+ * @date 	2014-10-09
+ * @brief	Register map and UDP protocol of the VME-EVR-230/RF, shared by the driver and the simulator
+ *
+ * This header depends on no EPICS header, so that tools speaking the protocol build without EPICS base.
+ */
+
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+/*System headers*/
+#include <stdint.h>
+
+/**
+ * @brief	VME-MRF-230/RF Register addresses
+ */
+typedef enum
+{
+	REGISTER_CONTROL		=	0x00,
+	REGISTER_MAP_ADDRESS	=	0x02,
+	REGISTER_MAP_DATA		=	0x04,
+	REGISTER_PULSE_ENABLE	=	0x06,
+	REGISTER_LEVEL_ENABLE	=	0x08,
+	REGISTER_TRIGGER_ENABLE	=	0x0a,
+	REGISTER_TIME_LO		=	0x0c,
+	REGISTER_TIME_HI		=	0x0e,
+	REGISTER_FIFO_TIME_LO	=	0x10,
+	REGISTER_FIFO_TIME_HI	=	0x12,
+	REGISTER_FIFO_EVENT		=	0x14,
+	REGISTER_PDP_ENABLE		=	0x18,
+	REGISTER_PULSE_SELECT	=	0x1a,
+	REGISTER_DATABUF_CONTROL=	0x20,
+	REGISTER_DBUS_ENABLE	=	0x24,
+	REGISTER_DBUS_DATA		=	0x26,
+	REGISTER_PULSE_PRESCALAR=	0x28,
+	REGISTER_FIRMWARE		=	0x2e,
+	REGISTER_FP_TTL7		=	0x3e,
+	REGISTER_FP_TTL0		=	0x40,
+	REGISTER_FP_TTL1		=	0x42,
+	REGISTER_FP_TTL2		=	0x44,
+	REGISTER_FP_TTL3		=	0x46,
+	REGISTER_FP_TTL4		=	0x48,
+	REGISTER_FP_TTL5		=	0x4a,
+	REGISTER_FP_TTL6		=	0x4c,
+	REGISTER_USEC_DIVIDER	=	0x4e,
+	REGISTER_EXTERNAL_EVENT	=	0x50,
+	REGISTER_CLOCK_CONTROL	=	0x52,
+	REGISTER_PULSE_POLARITY	=	0x68,
+	REGISTER_PULSE_DELAY	=	0x6c,
+	REGISTER_PULSE_WIDTH	=	0x70,
+	REGISTER_PRESCALAR_0	=	0x74,
+	REGISTER_PRESCALAR_1	=	0x76,
+	REGISTER_PRESCALAR_2	=	0x78,
+	REGISTER_FRAC_DIVIDER	=	0x80,
+	REGISTER_FP_UNIV0		=	0x90,
+	REGISTER_FP_UNIV1		=	0x92,
+	REGISTER_FP_UNIV2		=	0x94,
+	REGISTER_FP_UNIV3		=	0x96,
+	REGISTER_FP_UNIVGPIO	=	0x98,
+	REGISTER_CML4_ENABLE	=	0xb2,
+	REGISTER_CML4_HP		=	0xb4,
+	REGISTER_CML4_LP		=	0xb6,
+	REGISTER_CML5_ENABLE	=	0xd2,
+	REGISTER_CML5_HP		=	0xd4,
+	REGISTER_CML5_LP		=	0xd6,
+	REGISTER_CML6_ENABLE	=	0xf2,
+	REGISTER_CML6_HP		=	0xf4,
+	REGISTER_CML6_LP		=	0xf6,
+	REGISTER_DATABUF_DATA	=	0x800,
+} evrregister_t;
+
+/*Register bit definitions*/
+#define CONTROL_EVR_ENABLE	0x8000
+#define CONTROL_MAP_ENABLE	0x0200
+#define CONTROL_FLUSH		0x0080
+#define CONTROL_RXVIO		0x0001
+#define PULSE_ENABLE_ALL	0x03FF
+#define PULSE_SELECT_OFFSET	16
+#define FP_MUX_PDP0			0
+#define FP_MUX_PDP1			1
+#define FP_MUX_PDP2			2
+#define FP_MUX_PDP3			3
+#define FP_MUX_OTP0			11	
+#define FP_MUX_OTP1			12	
+#define FP_MUX_OTP2			13	
+#define FP_MUX_OTP3			14	
+#define FP_MUX_OTP4			15	
+#define FP_MUX_OTP5			16	
+#define FP_MUX_OTP6			17	
+#define FP_MUX_OTP7			18	
+#define FP_MUX_OTP8			19	
+#define FP_MUX_PRE0			40	
+#define FP_MUX_PRE1			41
+#define FP_MUX_PRE2			42	
+#define CML_FREQUENCY_MODE	0x0010
+#define CML_ENABLE			0x0001
+#define DATABUF_RECEIVE		0x8000	/*Written to arm the receiver for the next buffer, read as set while it waits for one*/
+#define DATABUF_READY		0x4000	/*A buffer was received*/
+#define DATABUF_CHECKSUM	0x2000	/*The received buffer failed its checksum*/
+#define DATABUF_MODE		0x1000	/*Data transmission is enabled, sharing the bandwidth of the distributed bus*/
+#define DATABUF_SIZE		0x0fff	/*Size of the received buffer in bytes*/
+
+/*EVR UDP packet field defitions*/
+#define ACCESS_READ		(1)
+#define ACCESS_WRITE	(2)
+
+/*EVR register base address*/
+#define REGISTER_BASE_ADDRESS	0x7a000000
+
+/*Number of entries of the mapping RAM, one per event code*/
+#define NUMBER_OF_EVENTS		256
+/*Number of values REGISTER_PULSE_SELECT can take*/
+#define NUMBER_OF_SELECTS		32
+/*Number of registers behind REGISTER_PULSE_SELECT*/
+#define PULSE_REGISTERS			5
+
+/** @brief message_t is the UDP message sent/received to/from the device*/
+typedef struct
+{
+	uint8_t		access;		/*Read/Write*/
+	uint8_t		status;		/*Filled by device*/
+	uint16_t	data;		/*Register data*/
+	uint32_t	address;	/*Register address*/
+	uint32_t	reference;	/*Request tag, echoed back by the device*/
+} message_t;
+
+#endif /*__PROTOCOL_H__*/
@@ -0,0 +1,408 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3.0 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Abdallah Ismail <abdallah.ismail@sesame.org.jo>, 2015
+ */
+
+/*
+ * @file 	waveform.c
+ * @author	Abdallah Ismail (abdallah.ismail@sesame.org.jo)
+ * @date 	10/15/2026
+ * @brief	Implements epics device support layer for the PMC-EVR230 event receiver
+ */
+
+/*Standard includes*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*EPICS includes*/
+#include <epicsExport.h>
+#include <devSup.h>
+#include <errlog.h>
+#include <dbAccess.h>
+#include <recSup.h>
+#include <recGbl.h>
+#include <alarm.h>
+#include <menuFtype.h>
+#include <waveformRecord.h>
+
+/*Application includes*/
+#include "parse.h"
+#include "evr.h"
+
+/*Macros*/
+#define EVENT_CHUNK		64		/*Number of events received at once by event streams*/
+
+/*Function prototypes*/
+static	long	initRecord	(waveformRecord *record);
+static 	long	ioRecord	(waveformRecord *record);
+static	void	process		(void* arg);
+static	long	getMapTable	(io_t *private, void *record);
+static	long	setMapTable	(io_t *private, void *record);
+static	long	getTimeoutHistogram	(io_t *private, void *record);
+static	long	getEventStream	(io_t *private, void *record);
+static	long	getDataBuffer	(io_t *private, void *record);
+static	long	ioIntInfo	(int command, waveformRecord *record, IOSCANPVT *scan);
+
+/*Commands understood by waveform records*/
+static	const	command_t	commands[]	=
+{
+	{"getMapTable",	getMapTable},
+	{"setMapTable",	setMapTable},
+	{"getTimeoutHistogram",	getTimeoutHistogram},
+	{"getEventStream",	getEventStream},
+	{"getDataBuffer",	getDataBuffer},
+	{NULL,	NULL}
+};
+
+/*Function definitions*/
+
+/** 
+ * @brief 	Initializes the record
+ *
+ * This function is called by recordInit during IOC initialization.
+ * For each record of this type, this function attemps the following:
+ * 	Checks record parameters.
+ * 	Parses record parameters.
+ * 	Sets record's private structure.
+ *
+ * @param	record	:	Pointer to record being initialized.
+ * @return	0 on success, -1 on failure.
+ */
+static long 
+initRecord(waveformRecord *record)
+{
+	int32_t	status;
+	io_t	*private;
+
+	if (record->inp.type != INST_IO) 
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Illegal io type\r\n", record->name);
+		return -1;
+	}
+
+	private	=	evr_allocate();
+	if (!private)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Could not allocate private structure\r\n", record->name);
+		return -1;
+	}
+
+	status			=	evr_parse(private, record->inp.value.instio.string);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Could not parse parameters\r\n", record->name);
+		return -1;
+	}
+
+	status			=	evr_resolve(private, commands);
+	if (status < 0)
+	{
+		printf("[evr][initRecord] Unable to initialize %s: Unknown command\r\n", record->name);
+		return -1;
+	}
+
+	if ((private->handler == getMapTable || private->handler == setMapTable) &&
+		(record->ftvl != menuFtypeUSHORT || record->nelm < NUMBER_OF_EVENTS))
+	{
+		printf("[evr][initRecord] Unable to initialize %s: FTVL must be USHORT and NELM at least %d\r\n", record->name, NUMBER_OF_EVENTS);
+		return -1;
+	}
+	if (private->handler == getTimeoutHistogram && (record->ftvl != menuFtypeULONG || record->nelm < NUMBER_OF_BINS))
+	{
+		printf("[evr][initRecord] Unable to initialize %s: FTVL must be ULONG and NELM at least %d\r\n", record->name, NUMBER_OF_BINS);
+		return -1;
+	}
+	if (private->handler == getEventStream && (record->ftvl != menuFtypeULONG || record->nelm < 2))
+	{
+		printf("[evr][initRecord] Unable to initialize %s: FTVL must be ULONG and NELM at least 2\r\n", record->name);
+		return -1;
+	}
+
+	if (private->handler == getDataBuffer && (record->ftvl != menuFtypeUCHAR || record->nelm > DATA_SIZE))
+	{
+		printf("[evr][initRecord] Unable to initialize %s: FTVL must be UCHAR and NELM at most %d\r\n", record->name, DATA_SIZE);
+		return -1;
+	}
+
+	private->device	=	evr_open(private->name);	
+	if (private->device == NULL)
+	{
+		printf("[evr][initRecord] Unable to initalize %s: Could not open device\r\n", record->name);
+		return -1;
+	}
+
+	/*Event streams follow the events of the device on their own*/
+	if (private->handler == getEventStream)
+	{
+		if (posix_memalign(&private->context, CACHE_LINE, sizeof(evrsubscriber_t)) || evr_subscribe(private->device, private->context) < 0)
+		{
+			printf("[evr][initRecord] Unable to initalize %s: Could not subscribe to events\r\n", record->name);
+			return -1;
+		}
+	}
+
+	record->dpvt	=	private;
+
+	return 0;
+}
+
+/** 
+ * @brief 	Performs IO on the record.
+ *
+ * This function is called by record support to perform IO on the record
+ * This function attemps the following:
+ * 	Checks record parameters.
+ * 	Executes record IO.
+ *
+ * @param	record	:	Pointer to record being initialized.
+ * @return	0 on success, -1 on failure.
+ */
+static long 
+ioRecord(waveformRecord *record)
+{
+	int32_t		status	=	0;
+	io_t*		private	=	(io_t*)record->dpvt;
+
+	if (!record)
+	{
+		printf("[evr][ioRecord] Unable to perform io on %s: Null record pointer\r\n", record->name);
+		return -1;
+	}
+    if (!private)
+    {
+        printf("[evr][ioRecord] Unable to perform io on %s: Null private structure pointer\r\n", record->name);
+        return -1;
+    }
+	if (!private->command || !strlen(private->command))
+	{
+		printf("[evr][ioRecord] Unable to perform io on %s: Command is null or empty\r\n", record->name);
+		return -1;
+	}
+
+	/*
+	 * Start IO
+	 */
+
+	/*If this is the first pass then queue IO to the device's worker pool, set PACT, and return*/
+	if(!record->pact)
+	{
+		status	=	evr_submit(private->device, process, (void*)record);
+		if (status < 0)
+		{
+			evr_log("[evr][ioRecord] Unable to perform IO on %s: Unable to queue request\n", record->name);
+			recGblSetSevr(record, SCAN_ALARM, INVALID_ALARM);
+			return -1;
+		}
+		record->pact = true;
+		return 0;
+	}
+
+	/*
+	 * This is the second pass, complete the request and return
+	 */
+	if (private->status	< 0)
+	{
+		evr_log("[evr][ioRecord] Unable to perform IO on %s\n", record->name);
+		recGblSetSevr(record, evr_getAlarm(private, READ_ALARM), INVALID_ALARM);
+		record->pact=	false;
+		return -1;
+	}
+	record->pact	=	false;
+
+	return 0;
+}
+
+/** 
+ * @brief 	Performs asynchronousIO on the record
+ *
+ * This function is executed by a worker of the device's pool and attemps the following:
+ * 	Performs the requested IO
+ *	Processes the record to finalize IO
+ *
+ * @param	arg	:	Pointer to the record
+ */
+static void
+process(void* arg)
+{
+	int				status	=	0;
+	waveformRecord*	record	=	(waveformRecord*)arg;
+	io_t*			private	=	(io_t*)record->dpvt;
+
+	private->status	=	0;
+
+	status	=	private->handler(private, record);
+	if (status < 0)
+	{
+		evr_log("[evr][process] Unable to io %s\n", record->name);
+		private->status	=	-1;
+		private->error	=	evr_getError();
+	}
+
+	/*Process record*/
+	dbScanLock((struct dbCommon*)record);
+	(record->rset->process)(record);
+	dbScanUnlock((struct dbCommon*)record);
+}
+
+/** 
+ * @brief 	Command handlers, resolved from the command table by initRecord
+ *
+ * @param	private	:	Private structure of the record
+ * @param	record	:	Pointer to the record
+ * @return	0 on success, -1 on failure
+ */
+static long
+getMapTable(io_t *private, void *record)
+{
+	waveformRecord*	waveform	=	(waveformRecord*)record;
+
+	if (evr_getMapTable(private->device, (uint16_t*)waveform->bptr) < 0)
+		return -1;
+	waveform->nord	=	NUMBER_OF_EVENTS;
+	return 0;
+}
+
+static long
+setMapTable(io_t *private, void *record)
+{
+	waveformRecord*	waveform	=	(waveformRecord*)record;
+
+	/*Events beyond the elements of the array are mapped to no action*/
+	memset((uint16_t*)waveform->bptr + waveform->nord, 0, (waveform->nelm - waveform->nord)*sizeof(uint16_t));
+	return evr_setMapTable(private->device, (uint16_t*)waveform->bptr);
+}
+
+static long
+getTimeoutHistogram(io_t *private, void *record)
+{
+	waveformRecord*	waveform	=	(waveformRecord*)record;
+
+	if (evr_getTimeoutHistogram(private->device, (uint32_t*)waveform->bptr) < 0)
+		return -1;
+	waveform->nord	=	NUMBER_OF_BINS;
+	return 0;
+}
+
+static long
+getEventStream(io_t *private, void *record)
+{
+	uint32_t		i;
+	uint32_t		count;
+	uint32_t		*data;
+	evrevent_t		events[EVENT_CHUNK];
+	waveformRecord*	waveform	=	(waveformRecord*)record;
+
+	/*Elements are code and timestamp pairs of the events received since the last scan, oldest first*/
+	data			=	(uint32_t*)waveform->bptr;
+	waveform->nord	=	0;
+	do
+	{
+		count	=	(waveform->nelm - waveform->nord)/2;
+		if (evr_receive((evrsubscriber_t*)private->context, events, count < EVENT_CHUNK ? count : EVENT_CHUNK, &count) < 0)
+			return -1;
+		for (i = 0; i < count; i++)
+		{
+			data[waveform->nord++]	=	events[i].code;
+			data[waveform->nord++]	=	events[i].stamp;
+		}
+	}
+	while (count == EVENT_CHUNK);
+
+	return 0;
+}
+
+/*
+ * Data buffers are not copied into the record, the record takes the received buffer
+ * in place of its own array, holding it until the next one. Ownership changes under
+ * the record lock, so readers of the array never see a buffer being refilled.
+ */
+static long
+getDataBuffer(io_t *private, void *record)
+{
+	evrbuffer_t		*buffer;
+	evrbuffer_t		*previous;
+	waveformRecord*	waveform	=	(waveformRecord*)record;
+
+	if (evr_acquireData(private->device, &buffer) < 0)
+		return -1;
+
+	dbScanLock((struct dbCommon*)record);
+	previous		=	(evrbuffer_t*)private->context;
+	waveform->bptr	=	buffer->data;
+	waveform->nord	=	(buffer->size < waveform->nelm) ? buffer->size : waveform->nelm;
+	private->context=	buffer;
+	dbScanUnlock((struct dbCommon*)record);
+
+	if (previous)
+		evr_releaseData(previous);
+	return 0;
+}
+
+/** 
+ * @brief 	Returns the I/O Intr scan list of the record
+ *
+ * Data buffer records are scanned whenever a buffer is received.
+ *
+ * @param	command	:	0 if the record is added to the scan list, 1 if it is deleted
+ * @param	record	:	Pointer to the record
+ * @param	scan	:	The scan list
+ * @return	0 on success, -1 on failure
+ */
+static long
+ioIntInfo(int command, waveformRecord *record, IOSCANPVT *scan)
+{
+	io_t*	private	=	(io_t*)record->dpvt;
+
+	if (!private)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: Null private structure pointer\r\n", record->name);
+		return -1;
+	}
+
+	if (private->handler != getDataBuffer)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s: \"%s\" cannot be scanned on I/O Intr\r\n", record->name, private->command);
+		return -1;
+	}
+
+	if (evr_getDataScan(private->device, scan) < 0)
+	{
+		printf("[evr][ioIntInfo] Unable to scan %s\r\n", record->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct devsup {
+    long	  number;
+    DEVSUPFUN report;
+    DEVSUPFUN init;
+    DEVSUPFUN init_record;
+    DEVSUPFUN get_ioint_info;
+    DEVSUPFUN io;
+} waveformevr =
+{
+    5,
+    NULL,
+    NULL,
+    initRecord,
+    ioIntInfo,
+    ioRecord
+};
+epicsExportAddress(dset, waveformevr);